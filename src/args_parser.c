@@ -12,6 +12,14 @@
 #define DEFAULT_GRAPH_INDEX 0
 #define DEFAULT_FORMAT FORMAT_TEXT
 #define DEFAULT_NUM_ATTEMPTS 10
+#define DEFAULT_EIGENSOLVER EIGENSOLVER_POWER
+#define DEFAULT_PRECONDITIONER PRECONDITIONER_MULTIGRID
+#define DEFAULT_KMEANS_INIT KMEANS_INIT_PLUSPLUS // wczesniej random; kmeans++ tnie mniej krawedzi
+#define DEFAULT_KMEANS_ALGORITHM KMEANS_HAMERLY // wczesniej lloyd; ten sam podzial, szybciej
+#define DEFAULT_BATCH_SIZE 1024
+#define DEFAULT_BATCH_ITERATIONS 100
+#define DEFAULT_REFINE REFINE_FM
+#define DEFAULT_REFINE_PASSES 8
 
 void init_config(Config *config) {
     if (!config) {
@@ -27,6 +35,18 @@ void init_config(Config *config) {
     config->verbose = 0;
     config->seed = (unsigned int)time(NULL);
     config->num_attempts = DEFAULT_NUM_ATTEMPTS;
+    config->convert_filename = NULL;
+    config->eigensolver = DEFAULT_EIGENSOLVER;
+    config->preconditioner = DEFAULT_PRECONDITIONER;
+    config->multilevel = 0;
+    config->reorder = REORDER_NONE;
+    config->refine = DEFAULT_REFINE;
+    config->refine_passes = DEFAULT_REFINE_PASSES;
+    config->kmeans_algorithm = DEFAULT_KMEANS_ALGORITHM;
+    config->kmeans_init = DEFAULT_KMEANS_INIT;
+    config->batch_size = DEFAULT_BATCH_SIZE;
+    config->batch_iterations = DEFAULT_BATCH_ITERATIONS;
+    config->num_threads = 0;
 }
 
 void free_config(Config *config) {
@@ -36,6 +56,7 @@ void free_config(Config *config) {
 
     free(config->input_filename);
     free(config->output_filename);
+    free(config->convert_filename);
 }
 
 char *get_file_extension(char *filename) {
@@ -82,18 +103,35 @@ int parse_args(int argc, char *argv[], Config *config) {
         if (strcmp(argv[i], "--input") == 0) {
             if (++i < argc) {
                 char *input_ext = get_file_extension(argv[i]);
-                if (strcmp(input_ext, "csrrg") != 0) {
+                if (strcmp(input_ext, "csrrg") != 0 && strcmp(input_ext, "gpbin") != 0) {
                     error("Niepoprawny format pliku wejściowego. Użyj "
                           "formatu "
-                          "csrrg.\n");
+                          "csrrg lub gpbin.\n");
                     free_config(config);
                     return 0;
                 }
+                free(config->input_filename);
                 config->input_filename = strdup(argv[i]);
             } else {
                 error("Brakuje nazwy pliku wejściowego.\n");
                 return 0;
             }
+        } else if (strcmp(argv[i], "--convert") == 0) {
+            if (i + 2 < argc) {
+                if (strcmp(get_file_extension(argv[i + 1]), "csrrg") != 0) {
+                    error("Konwertować można tylko pliki w formacie csrrg.\n");
+                    free_config(config);
+                    return 0;
+                }
+                free(config->input_filename);
+                config->input_filename = strdup(argv[i + 1]);
+                free(config->convert_filename);
+                config->convert_filename = ensure_extension(argv[i + 2], "gpbin");
+                i += 2;
+            } else {
+                error("Brakuje nazwy pliku wejściowego lub wyjściowego konwersji.\n");
+                return 0;
+            }
         } else if (strcmp(argv[i], "--output") == 0) {
             if (++i < argc) {
                 free(config->output_filename);
@@ -190,6 +228,18 @@ int parse_args(int argc, char *argv[], Config *config) {
                 error("Brakuje wartości liczby powtórzeń.\n");
                 return 0;
             }
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            if (++i < argc) {
+                int threads = atoi(argv[i]);
+                if (threads < 1) {
+                    error("Liczba wątków musi być liczbą całkowitą większą lub równą 1.\n");
+                    return 0;
+                }
+                config->num_threads = threads;
+            } else {
+                error("Brakuje wartości liczby wątków.\n");
+                return 0;
+            }
         } else if (strcmp(argv[i], "--seed") == 0) {
             if (++i < argc) {
                 unsigned int seed = (unsigned int)atoi(argv[i]);
@@ -198,6 +248,151 @@ int parse_args(int argc, char *argv[], Config *config) {
                 error("Brakuje wartości ziarna.\n");
                 return 0;
             }
+        } else if (strcmp(argv[i], "--eigensolver") == 0) {
+            if (++i < argc) {
+                if (strcmp(argv[i], "power") == 0) {
+                    config->eigensolver = EIGENSOLVER_POWER;
+                } else if (strcmp(argv[i], "lanczos") == 0) {
+                    config->eigensolver = EIGENSOLVER_LANCZOS;
+                } else if (strcmp(argv[i], "lobpcg") == 0) {
+                    config->eigensolver = EIGENSOLVER_LOBPCG;
+                } else if (strcmp(argv[i], "chebyshev") == 0) {
+                    config->eigensolver = EIGENSOLVER_CHEBYSHEV;
+                } else {
+                    error("Niepoprawna metoda wektorów własnych. Wpisz 'power', "
+                          "'lanczos', 'lobpcg' lub 'chebyshev'.\n");
+                    return 0;
+                }
+            } else {
+                error("Brakuje nazwy metody wektorów własnych.\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--preconditioner") == 0) {
+            if (++i < argc) {
+                if (strcmp(argv[i], "none") == 0) {
+                    config->preconditioner = PRECONDITIONER_NONE;
+                } else if (strcmp(argv[i], "jacobi") == 0) {
+                    config->preconditioner = PRECONDITIONER_JACOBI;
+                } else if (strcmp(argv[i], "multigrid") == 0) {
+                    config->preconditioner = PRECONDITIONER_MULTIGRID;
+                } else {
+                    error("Niepoprawny prekondycjoner. Wpisz 'none', 'jacobi' lub "
+                          "'multigrid'.\n");
+                    return 0;
+                }
+            } else {
+                error("Brakuje nazwy prekondycjonera.\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--multilevel") == 0) {
+            config->multilevel = 1;
+        } else if (strcmp(argv[i], "--kmeans") == 0) {
+            if (++i < argc) {
+                if (strcmp(argv[i], "lloyd") == 0) {
+                    config->kmeans_algorithm = KMEANS_LLOYD;
+                } else if (strcmp(argv[i], "hamerly") == 0) {
+                    config->kmeans_algorithm = KMEANS_HAMERLY;
+                } else if (strcmp(argv[i], "elkan") == 0) {
+                    config->kmeans_algorithm = KMEANS_ELKAN;
+                } else if (strcmp(argv[i], "minibatch") == 0) {
+                    config->kmeans_algorithm = KMEANS_MINIBATCH;
+                } else {
+                    error("Niepoprawna metoda k-średnich. Wpisz 'lloyd', 'hamerly', 'elkan' "
+                          "lub 'minibatch'.\n");
+                    return 0;
+                }
+            } else {
+                error("Brakuje nazwy metody k-średnich.\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--batch-size") == 0) {
+            if (++i < argc) {
+                int batch_size = atoi(argv[i]);
+                if (batch_size < 1) {
+                    error("Rozmiar próbki musi być liczbą całkowitą większą lub równą 1.\n");
+                    return 0;
+                }
+                config->batch_size = batch_size;
+            } else {
+                error("Brakuje wartości rozmiaru próbki.\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--batch-iterations") == 0) {
+            if (++i < argc) {
+                int batch_iterations = atoi(argv[i]);
+                if (batch_iterations < 1) {
+                    error("Liczba próbek musi być liczbą całkowitą większą lub równą 1.\n");
+                    return 0;
+                }
+                config->batch_iterations = batch_iterations;
+            } else {
+                error("Brakuje wartości liczby próbek.\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--kmeans-init") == 0) {
+            if (++i < argc) {
+                if (strcmp(argv[i], "random") == 0) {
+                    config->kmeans_init = KMEANS_INIT_RANDOM;
+                } else if (strcmp(argv[i], "kmeans++") == 0) {
+                    config->kmeans_init = KMEANS_INIT_PLUSPLUS;
+                } else if (strcmp(argv[i], "kmeans-parallel") == 0) {
+                    config->kmeans_init = KMEANS_INIT_PARALLEL;
+                } else if (strcmp(argv[i], "farthest") == 0) {
+                    config->kmeans_init = KMEANS_INIT_FARTHEST;
+                } else {
+                    error("Niepoprawna metoda wyboru centroidów. Wpisz 'random', 'kmeans++', "
+                          "'kmeans-parallel' lub 'farthest'.\n");
+                    return 0;
+                }
+            } else {
+                error("Brakuje nazwy metody wyboru centroidów.\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--refine") == 0) {
+            if (++i < argc) {
+                if (strcmp(argv[i], "fm") == 0) {
+                    config->refine = REFINE_FM;
+                } else if (strcmp(argv[i], "lp") == 0) {
+                    config->refine = REFINE_LABEL_PROPAGATION;
+                } else {
+                    error("Niepoprawna metoda rafinacji. Wpisz 'fm' lub 'lp'.\n");
+                    return 0;
+                }
+            } else {
+                error("Brakuje nazwy metody rafinacji.\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--refine-passes") == 0) {
+            if (++i < argc) {
+                int passes = atoi(argv[i]);
+                if (passes < 0) {
+                    error("Liczba przebiegów rafinacji musi być liczbą całkowitą nieujemną.\n");
+                    return 0;
+                }
+                config->refine_passes = passes;
+            } else {
+                error("Brakuje wartości liczby przebiegów rafinacji.\n");
+                return 0;
+            }
+        } else if (strcmp(argv[i], "--reorder") == 0) {
+            if (++i < argc) {
+                if (strcmp(argv[i], "none") == 0) {
+                    config->reorder = REORDER_NONE;
+                } else if (strcmp(argv[i], "rcm") == 0) {
+                    config->reorder = REORDER_RCM;
+                } else if (strcmp(argv[i], "morton") == 0) {
+                    config->reorder = REORDER_MORTON;
+                } else if (strcmp(argv[i], "hilbert") == 0) {
+                    config->reorder = REORDER_HILBERT;
+                } else {
+                    error("Niepoprawna metoda przenumerowania. Wpisz 'none', 'rcm', "
+                          "'morton' lub 'hilbert'.\n");
+                    return 0;
+                }
+            } else {
+                error("Brakuje nazwy metody przenumerowania.\n");
+                return 0;
+            }
         } else if (strcmp(argv[i], "--verbose") == 0) {
             config->verbose = 1;
         } else if (strcmp(argv[i], "--help") == 0) {
@@ -212,9 +407,13 @@ int parse_args(int argc, char *argv[], Config *config) {
             printf("\n");
             printf("Opcje:\n");
             printf("  --input <filename>\n");
-            printf("        Nazwa pilku wejściowego w formacie csrrg "
+            printf("        Nazwa pilku wejściowego w formacie csrrg lub gpbin "
                    "[wymagane]\n");
             printf("\n");
+            printf("  --convert <input.csrrg> <output.gpbin>\n");
+            printf("        Zamienia graf o indeksie --graph-index na binarny format gpbin, "
+                   "który wczytuje się bez parsowania, i kończy działanie\n");
+            printf("\n");
             printf("  --format <text|binary>\n");
             printf("        Format wyjściowy [domyślnie: text]\n");
             printf("\n");
@@ -245,6 +444,67 @@ int parse_args(int argc, char *argv[], Config *config) {
             printf("        Ziarno losowości w algorytmie k-średnich [domyślnie: aktualny "
                    "timestamp]\n");
             printf("\n");
+            printf("  --eigensolver <power|lanczos|lobpcg|chebyshev>\n");
+            printf("        Metoda wyznaczania wektorów własnych macierzy Laplace'a: "
+                   "metoda potęgowa, Lanczos z restartem, blokowy LOBPCG albo iteracja "
+                   "podprzestrzeni z filtrem Czebyszewa (zalecana dla wielu partycji) dla "
+                   "najmniejszych wartości własnych [domyślnie: power]\n");
+            printf("\n");
+            printf("  --preconditioner <none|jacobi|multigrid>\n");
+            printf("        Prekondycjoner metody LOBPCG: brak, diagonala stopni albo "
+                   "cykl multigrid z agregacją wierzchołków [domyślnie: multigrid]\n");
+            printf("\n");
+            printf("  --threads <number>\n");
+            printf("        Liczba wątków obliczeniowych [domyślnie: liczba rdzeni lub "
+                   "OMP_NUM_THREADS]\n");
+            printf("\n");
+            printf("  --multilevel\n");
+            printf("        Zgrubia graf dopasowaniem ciężkich krawędzi, dzieli spektralnie "
+                   "najgrubszy poziom i rzutuje podział z powrotem z rafinacją na każdym "
+                   "poziomie; zalecane dla bardzo dużych grafów\n");
+            printf("\n");
+            printf("  --kmeans <lloyd|hamerly|elkan|minibatch>\n");
+            printf("        Wariant k-średnich: pełne przeliczanie odległości (Lloyd) albo "
+                   "pomijanie odległości, które nie mogą zmienić przydziału, dzięki "
+                   "granicom z nierówności trójkąta (Hamerly; Elkan z granicą dla każdego "
+                   "centroidu, szybszy przy wielu partycjach, ale zajmuje V x k pamięci). "
+                   "Wszystkie trzy dają ten sam podział. Mini-batch aktualizuje centroidy "
+                   "na losowych próbkach wierzchołków i kończy jednym pełnym przydziałem; "
+                   "jest dużo szybszy dla bardzo dużych grafów kosztem nieco gorszego "
+                   "grupowania [domyślnie: hamerly]\n");
+            printf("\n");
+            printf("  --batch-size <number>\n");
+            printf("        Liczba wierzchołków w jednej próbce k-średnich mini-batch "
+                   "[domyślnie: %d]\n", DEFAULT_BATCH_SIZE);
+            printf("\n");
+            printf("  --batch-iterations <number>\n");
+            printf("        Liczba próbek k-średnich mini-batch przed pełnym przydziałem "
+                   "[domyślnie: %d]\n", DEFAULT_BATCH_ITERATIONS);
+            printf("\n");
+            printf("  --kmeans-init <random|kmeans++|kmeans-parallel|farthest>\n");
+            printf("        Wybór początkowych centroidów k-średnich: losowe wierzchołki, "
+                   "losowanie proporcjonalne do kwadratu odległości (k-means++), jego "
+                   "wariant z nadpróbkowaniem w kilku rundach (k-means||) albo kolejno "
+                   "najdalsze punkty [domyślnie: kmeans++; wcześniejsze wersje używały "
+                   "random]\n");
+            printf("\n");
+            printf("  --refine <fm|lp>\n");
+            printf("        Rafinacja podziału: sekwencyjna Fiduccii-Mattheysesa albo "
+                   "równoległa propagacja etykiet z ograniczeniem rozmiaru części, "
+                   "znacznie szybsza dla bardzo dużych grafów kosztem nieco większego "
+                   "przecięcia; obie dają ten sam wynik niezależnie od liczby wątków "
+                   "[domyślnie: fm]\n");
+            printf("\n");
+            printf("  --refine-passes <number>\n");
+            printf("        Największa liczba przebiegów (rund) rafinacji po podziale; 0 "
+                   "wyłącza rafinację [domyślnie: %d]\n", DEFAULT_REFINE_PASSES);
+            printf("\n");
+            printf("  --reorder <none|rcm|morton|hilbert>\n");
+            printf("        Przenumerowuje wierzchołki przed podziałem, żeby sąsiedzi leżeli "
+                   "blisko w pamięci: odwrócony Cuthill-McKee albo krzywa Mortona lub "
+                   "Hilberta po współrzędnych z pliku; wynik zapisywany jest w pierwotnej "
+                   "numeracji [domyślnie: none]\n");
+            printf("\n");
             printf("  --verbose\n");
             printf("        Włącza tryb szczegółowego wypisywania informacji o "
                    "przebiegu procesu partycjonowania\n");
@@ -268,11 +528,36 @@ void print_config(Config *config) {
     printf("\n");
     verbose("Konfiguracja programu:\n");
     verbose("Plik wejściowy:         %s\n", config->input_filename);
+    if (config->convert_filename) {
+        verbose("Konwersja do pliku:     %s\n", config->convert_filename);
+    }
     verbose("Format wyjściowy:       %s\n",
             config->output_format == FORMAT_TEXT ? "text" : "binary");
     verbose("Plik wyjściowy:         %s\n", config->output_filename);
     verbose("Liczba partycji:        %d\n", config->num_parts);
     verbose("Max. nierównowaga:      %.2f\n", config->max_imbalance);
     verbose("Indeks grafu:           %d\n", config->graph_index);
-    verbose("Liczba powtórzeń:       %d\n\n", config->num_attempts);
+    verbose("Liczba powtórzeń:       %d\n", config->num_attempts);
+    const char *eigensolver_names[] = {"power", "lanczos", "lobpcg", "chebyshev"};
+    const char *preconditioner_names[] = {"none", "jacobi", "multigrid"};
+    verbose("Wektory własne:         %s\n", eigensolver_names[config->eigensolver]);
+    verbose("Prekondycjoner:         %s\n", preconditioner_names[config->preconditioner]);
+    verbose("Tryb wielopoziomowy:    %s\n", config->multilevel ? "tak" : "nie");
+    const char *kmeans_names[] = {"lloyd", "hamerly", "elkan", "minibatch"};
+    verbose("Metoda k-średnich:      %s\n", kmeans_names[config->kmeans_algorithm]);
+    if (config->kmeans_algorithm == KMEANS_MINIBATCH) {
+        verbose("Próbki mini-batch:      %d x %d\n", config->batch_iterations, config->batch_size);
+    }
+    const char *kmeans_init_names[] = {"random", "kmeans++", "kmeans-parallel", "farthest"};
+    verbose("Centroidy początkowe:   %s\n", kmeans_init_names[config->kmeans_init]);
+    const char *refine_names[] = {"fm", "lp"};
+    verbose("Rafinacja:              %s\n", refine_names[config->refine]);
+    verbose("Przebiegi rafinacji:    %d\n", config->refine_passes);
+    const char *reorder_names[] = {"none", "rcm", "morton", "hilbert"};
+    verbose("Przenumerowanie:        %s\n", reorder_names[config->reorder]);
+    if (config->num_threads > 0) {
+        verbose("Liczba wątków:          %d\n\n", config->num_threads);
+    } else {
+        verbose("Liczba wątków:          domyślna\n\n");
+    }
 }
@@ -2,20 +2,53 @@
 #define ARGS_PARSER_H
 
 typedef enum { FORMAT_TEXT, FORMAT_BINARY } OutputFormat;
+typedef enum {
+    EIGENSOLVER_POWER,
+    EIGENSOLVER_LANCZOS,
+    EIGENSOLVER_LOBPCG,
+    EIGENSOLVER_CHEBYSHEV
+} EigensolverType;
+typedef enum {
+    PRECONDITIONER_NONE,
+    PRECONDITIONER_JACOBI,
+    PRECONDITIONER_MULTIGRID
+} PreconditionerType;
+typedef enum {
+    KMEANS_INIT_RANDOM,
+    KMEANS_INIT_PLUSPLUS,
+    KMEANS_INIT_PARALLEL,
+    KMEANS_INIT_FARTHEST
+} KmeansInit;
+typedef enum { KMEANS_LLOYD, KMEANS_HAMERLY, KMEANS_ELKAN, KMEANS_MINIBATCH } KmeansAlgorithm;
+typedef enum { REFINE_FM, REFINE_LABEL_PROPAGATION } RefineType;
+typedef enum { REORDER_NONE, REORDER_RCM, REORDER_MORTON, REORDER_HILBERT } ReorderType;
 
 typedef struct {
-    char *input_filename;       // Nazwa pliku wejsciowego
-    char *output_filename;      // Nazwa pliku wyjsciowego
-    int num_parts;              // Liczba partycji
-    float max_imbalance;        // Maksymalny wspolczynnik nierownowagl
-    int graph_index;            // Indeks grafu (jesli jest wiele grafow)
-    OutputFormat output_format; // Format wyjsciowy (text/binary)
-    int verbose;                // Tryb szczegolowego wypisywania
-    unsigned int seed;          // Ziarno losowosci (opcjonalne)
-    int num_attempts;           // Liczba prob (opcjonalne)
+    char *input_filename;              // Nazwa pliku wejsciowego
+    char *output_filename;             // Nazwa pliku wyjsciowego
+    int num_parts;                     // Liczba partycji
+    float max_imbalance;               // Maksymalny wspolczynnik nierownowagl
+    int graph_index;                   // Indeks grafu (jesli jest wiele grafow)
+    OutputFormat output_format;        // Format wyjsciowy (text/binary)
+    int verbose;                       // Tryb szczegolowego wypisywania
+    unsigned int seed;                 // Ziarno losowosci (opcjonalne)
+    int num_attempts;                  // Liczba prob (opcjonalne)
+    char *convert_filename;            // Plik gpbin tworzony w trybie konwersji (opcjonalne)
+    EigensolverType eigensolver;       // Metoda wyznaczania wektorow wlasnych
+    PreconditionerType preconditioner; // Prekondycjoner dla LOBPCG
+    int multilevel;                    // Tryb wielopoziomowy (zgrubianie grafu)
+    KmeansAlgorithm kmeans_algorithm;  // Wariant iteracji k-srednich
+    int batch_size;                    // Rozmiar probki w k-srednich mini-batch
+    int batch_iterations;              // Liczba probek w k-srednich mini-batch
+    KmeansInit kmeans_init;            // Wybor poczatkowych centroidow k-srednich
+    RefineType refine;                 // Metoda rafinacji podzialu
+    int refine_passes;                 // Liczba przebiegow rafinacji
+    ReorderType reorder;               // Przenumerowanie wierzcholkow przed podzialem
+    int num_threads;                   // Liczba watkow (0 - domyslna OpenMP)
 } Config;
 
 int parse_args(int argc, char *argv[], Config *config);
+char *get_file_extension(char *filename);
 void print_config(Config *config);
 void free_config(Config *config);
 
@@ -0,0 +1,278 @@
+#include "chebyshev.h"
+#include "log_utils.h"
+#include "printfcolor.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHEBYSHEV_TOLERANCE 1e-7
+#define CHEBYSHEV_MAX_ITERATIONS 200    // limit zewnetrznych iteracji
+#define CHEBYSHEV_DEGREE 20             // stopien wielomianu filtrujacego
+#define CHEBYSHEV_MIN_EXTRA_VECTORS 8   // wektory ponad liczbe szukanych, przyspieszaja zbieznosc
+#define CHEBYSHEV_LANCZOS_STEPS 10      // kroki Lanczosa przy szacowaniu gornej granicy widma
+
+// Gorna granica widma L z kilku krokow Lanczosa: najwieksza wartosc Ritza plus
+// ostatnia beta (Zhou, Li), ale nie wiecej niz granica Gerszgorina 2 * max stopien
+static double estimate_upper_bound(SparseMatrix *adj_matrix, int *products) {
+    int n = adj_matrix->rows;
+    int max_degree = 0;
+    for (int i = 0; i < n; i++) {
+        int degree = adj_matrix->row_ptr[i + 1] - adj_matrix->row_ptr[i];
+        if (degree > max_degree) {
+            max_degree = degree;
+        }
+    }
+    double gershgorin = 2.0 * max_degree;
+
+    int steps = CHEBYSHEV_LANCZOS_STEPS < n ? CHEBYSHEV_LANCZOS_STEPS : n;
+    double *v = malloc(n * sizeof(double));
+    double *v_prev = calloc(n, sizeof(double));
+    double *w = malloc(n * sizeof(double));
+    double *t = calloc((size_t)steps * steps, sizeof(double));
+    double *theta = malloc(steps * sizeof(double));
+    double *y = malloc((size_t)steps * steps * sizeof(double));
+    double *alpha = malloc(steps * sizeof(double));
+    double *beta = malloc(steps * sizeof(double));
+    if (!v || !v_prev || !w || !t || !theta || !y || !alpha || !beta) {
+        free(v);
+        free(v_prev);
+        free(w);
+        free(t);
+        free(theta);
+        free(y);
+        free(alpha);
+        free(beta);
+        return gershgorin;
+    }
+
+    DenseVector vv = {n, v};
+    DenseVector wv = {n, w};
+    for (int i = 0; i < n; i++) {
+        v[i] = 2.0 * rand() / RAND_MAX - 1.0;
+    }
+    normalize_vector(&vv);
+
+    int k = 0;
+    double beta_prev = 0.0;
+    while (k < steps) {
+        apply_laplacian(adj_matrix, &vv, &wv);
+        (*products)++;
+        alpha[k] = dot_product(&wv, &vv);
+        for (int i = 0; i < n; i++) {
+            w[i] -= alpha[k] * v[i] + beta_prev * v_prev[i];
+        }
+        beta[k] = sqrt(dot_product(&wv, &wv));
+        k++;
+        if (beta[k - 1] < 1e-12) {
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            v_prev[i] = v[i];
+            v[i] = w[i] / beta[k - 1];
+        }
+        beta_prev = beta[k - 1];
+    }
+
+    for (int i = 0; i < k; i++) {
+        t[i * k + i] = alpha[i];
+        if (i + 1 < k) {
+            t[i * k + i + 1] = beta[i];
+            t[(i + 1) * k + i] = beta[i];
+        }
+    }
+    double bound = gershgorin;
+    if (symmetric_eigen_decomposition(t, k, theta, y)) {
+        bound = fmin(theta[k - 1] + beta[k - 1], gershgorin);
+    }
+
+    free(v);
+    free(v_prev);
+    free(w);
+    free(t);
+    free(theta);
+    free(y);
+    free(alpha);
+    free(beta);
+    return bound;
+}
+
+// Skalowany filtr Czebyszewa stopnia CHEBYSHEV_DEGREE (Zhou, Saad): tlumi
+// skladowe z przedzialu [cutoff, upper], a wzmacnia te ponizej cutoff;
+// low to przyblizenie najmniejszej szukanej wartosci, wzgledem ktorej
+// wynik jest skalowany, zeby nie przepelnic zakresu. Blok jest zapisany
+// wierszami, wiec kazde mnozenie przez L czyta macierz raz dla wszystkich
+// wektorow. Wejscie *x jest niszczone; wskazniki sa zamieniane tak, ze
+// wynik jest w *x.
+static void chebyshev_filter(SparseMatrix *adj_matrix, double **x, double **y, double **z, int b,
+                             double low, double cutoff, double upper) {
+    int n = adj_matrix->rows;
+    size_t total = (size_t)n * b;
+    double e = (upper - cutoff) / 2.0;
+    double c = (upper + cutoff) / 2.0;
+    double sigma = e / (low - c);
+    double tau = 2.0 / sigma;
+    double *old;
+
+    multiply_sparse_matrix_block(adj_matrix, *x, *y, b, b);
+    for (size_t i = 0; i < total; i++) {
+        (*y)[i] = ((*y)[i] - c * (*x)[i]) * sigma / e;
+    }
+
+    for (int step = 2; step <= CHEBYSHEV_DEGREE; step++) {
+        double sigma_new = 1.0 / (tau - sigma);
+        multiply_sparse_matrix_block(adj_matrix, *y, *z, b, b);
+        for (size_t i = 0; i < total; i++) {
+            (*z)[i] = ((*z)[i] - c * (*y)[i]) * (2.0 * sigma_new / e) -
+                      sigma * sigma_new * (*x)[i];
+        }
+        old = *x;
+        *x = *y;
+        *y = *z;
+        *z = old;
+        sigma = sigma_new;
+    }
+
+    old = *x;
+    *x = *y;
+    *y = old;
+}
+
+// Iteracja podprzestrzeni z filtrem Czebyszewa dla najmniejszych
+// nietrywialnych wartosci wlasnych macierzy Laplace'a. Caly blok jest
+// filtrowany samymi mnozeniami przez L, a ortonormalizacja i metoda
+// Rayleigha-Ritza sa wykonywane raz na zewnetrzna iteracje, wiec koszt
+// rosnie z liczba wektorow prawie liniowo.
+DenseVector **compute_eigenvectors_chebyshev(SparseMatrix *adj_matrix, int num_eigenvectors,
+                                             EigensolverStats *stats) {
+    int n = adj_matrix ? adj_matrix->rows : 0;
+    int nev = num_eigenvectors;
+    if (!adj_matrix || nev <= 0 || nev > n - 1) {
+        error("Niepoprawne dane wejściowe.\n");
+        return NULL;
+    }
+
+    int extra = nev / 4 > CHEBYSHEV_MIN_EXTRA_VECTORS ? nev / 4 : CHEBYSHEV_MIN_EXTRA_VECTORS;
+    int b = nev + extra < n - 1 ? nev + extra : n - 1;
+
+    double *x = malloc((size_t)n * b * sizeof(double));
+    double *y = malloc((size_t)n * b * sizeof(double));
+    double *z = malloc((size_t)n * b * sizeof(double));
+    double *h = malloc((size_t)b * b * sizeof(double));
+    double *q = malloc((size_t)b * b * sizeof(double));
+    double *theta = malloc(b * sizeof(double));
+    double *residuals = malloc(b * sizeof(double));
+    DenseVector **eigenvectors = calloc(nev, sizeof(DenseVector *));
+    BlockWorkspace ws = {0};
+    if (!x || !y || !z || !h || !q || !theta || !residuals || !eigenvectors ||
+        !init_block_workspace(&ws, b, b, n)) {
+        error("Nie udało się zaalokować pamięci dla bazy filtru Czebyszewa.\n");
+        free(x);
+        free(y);
+        free(z);
+        free(h);
+        free(q);
+        free(theta);
+        free(residuals);
+        free(eigenvectors);
+        free_block_workspace(&ws);
+        return NULL;
+    }
+
+    int iterations = 0;
+    double upper = estimate_upper_bound(adj_matrix, &iterations);
+    double cutoff = upper / 2.0;
+    double low = 0.0;
+    for (size_t i = 0; i < (size_t)n * b; i++) {
+        x[i] = 2.0 * rand() / RAND_MAX - 1.0;
+    }
+
+    int outer = 0;
+    int converged = 0;
+    double max_residual = 0.0;
+    for (;;) {
+        if (cutoff > low && cutoff < upper) {
+            chebyshev_filter(adj_matrix, &x, &y, &z, b, low, cutoff, upper);
+            iterations += CHEBYSHEV_DEGREE * b;
+        }
+
+        int kept = orthonormalize_block(x, NULL, b, NULL, NULL, 0, b, n, &ws);
+        while (kept < b) {
+            // kolumny zlaly sie z pozostalymi - zastepuje je losowymi kierunkami
+            for (int i = 0; i < n; i++) {
+                for (int col = kept; col < b; col++) {
+                    x[(size_t)i * b + col] = 2.0 * rand() / RAND_MAX - 1.0;
+                }
+            }
+            kept += orthonormalize_block(x + kept, NULL, b - kept, x, NULL, kept, b, n, &ws);
+        }
+
+        multiply_sparse_matrix_block(adj_matrix, x, y, b, b);
+        iterations += b;
+        projected_laplacian_matrix(x, y, b, b, n, &ws, h);
+        if (!symmetric_eigen_decomposition(h, b, theta, q)) {
+            free_eigenvectors(eigenvectors, nev);
+            eigenvectors = NULL;
+            break;
+        }
+        block_combine(x, b, q, b, x, b, n, &ws);
+        block_combine(y, b, q, b, y, b, n, &ws);
+        outer++;
+
+        block_residual_norms(x, y, nev, theta, b, n, &ws, residuals);
+        converged = 0;
+        max_residual = 0.0;
+        for (int i = 0; i < nev; i++) {
+            max_residual = fmax(max_residual, residuals[i]);
+            converged += residuals[i] <= CHEBYSHEV_TOLERANCE * upper;
+        }
+        if (converged == nev || outer >= CHEBYSHEV_MAX_ITERATIONS) {
+            break;
+        }
+
+        // nastepny filtr tlumi wszystko powyzej najwiekszej wartosci Ritza bloku
+        low = theta[0];
+        cutoff = theta[b - 1];
+        printfc_fg(GREY, ". ");
+        fflush(stdout);
+    }
+
+    if (eigenvectors) {
+        for (int i = 0; i < nev; i++) {
+            eigenvectors[i] = malloc(sizeof(DenseVector));
+            if (!eigenvectors[i]) {
+                error("Nie udało się zaalokować pamięci dla wektora własnego: %d.\n", i);
+                free_eigenvectors(eigenvectors, nev);
+                eigenvectors = NULL;
+                break;
+            }
+            eigenvectors[i]->size = n;
+            eigenvectors[i]->values = malloc(n * sizeof(double));
+            if (!eigenvectors[i]->values) {
+                error("Nie udało się zaalokować pamięci dla wartości wektora własnego: %d.\n", i);
+                free_eigenvectors(eigenvectors, nev);
+                eigenvectors = NULL;
+                break;
+            }
+            for (int k = 0; k < n; k++) {
+                eigenvectors[i]->values[k] = x[(size_t)k * b + i];
+            }
+        }
+    }
+
+    if (stats) {
+        stats->iterations = iterations;
+        stats->restarts = outer;
+        stats->converged = converged;
+        stats->max_residual = max_residual;
+    }
+
+    free(x);
+    free(y);
+    free(z);
+    free(h);
+    free(q);
+    free(theta);
+    free(residuals);
+    free_block_workspace(&ws);
+    return eigenvectors;
+}
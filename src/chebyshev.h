@@ -0,0 +1,8 @@
+#ifndef CHEBYSHEV_H
+#define CHEBYSHEV_H
+#include "spectral_algorithm.h"
+
+DenseVector **compute_eigenvectors_chebyshev(SparseMatrix *adj_matrix, int num_eigenvectors,
+                                             EigensolverStats *stats);
+
+#endif
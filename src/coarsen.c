@@ -0,0 +1,145 @@
+#include "coarsen.h"
+#include "io_handler.h"
+#include "log_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static inline int vertex_weight(Graph *graph, int v) { return graph->vwgt ? graph->vwgt[v] : 1; }
+
+int total_vertex_weight(Graph *graph) {
+    if (!graph->vwgt) {
+        return graph->num_vertices;
+    }
+    int total = 0;
+    for (int v = 0; v < graph->num_vertices; v++) {
+        total += graph->vwgt[v];
+    }
+    return total;
+}
+
+// Dopasowanie ciezkich krawedzi (heavy-edge matching): wierzcholki sa
+// odwiedzane w losowej kolejnosci i kazdy wolny laczy sie z tym wolnym
+// sasiadem, z ktorym laczy go najciezsza krawedz, o ile suma wag nie
+// przekroczy max_vertex_weight. Pary staja sie wierzcholkami grafu
+// zgrubionego, a krawedzie miedzy nimi sumuja wagi. cmap (rozmiaru
+// graph->num_vertices) dostaje numer wierzcholka zgrubionego dla kazdego
+// wierzcholka wejsciowego.
+Graph *coarsen_graph(Graph *graph, int *cmap, int max_vertex_weight) {
+    int n = graph->num_vertices;
+    int nnz = graph->xadj[n];
+    int *order = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *match = malloc((n > 0 ? n : 1) * sizeof(int));
+    Graph *coarse = calloc(1, sizeof(Graph));
+    if (!order || !match || !coarse) {
+        error("Nie udało się zaalokować pamięci dla zgrubiania grafu.\n");
+        free(order);
+        free(match);
+        free(coarse);
+        return NULL;
+    }
+
+    for (int v = 0; v < n; v++) {
+        order[v] = v;
+        match[v] = -1;
+    }
+    for (int i = n - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+
+    for (int i = 0; i < n; i++) {
+        int v = order[i];
+        if (match[v] >= 0) {
+            continue;
+        }
+        int best = v;
+        int best_weight = 0;
+        for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+            int u = graph->adjncy[j];
+            int weight = graph->adjwgt ? graph->adjwgt[j] : 1;
+            if (match[u] < 0 && u != v && weight > best_weight &&
+                vertex_weight(graph, v) + vertex_weight(graph, u) <= max_vertex_weight) {
+                best = u;
+                best_weight = weight;
+            }
+        }
+        match[v] = best;
+        match[best] = v;
+    }
+
+    int nc = 0;
+    for (int v = 0; v < n; v++) {
+        if (v <= match[v]) {
+            cmap[v] = nc;
+            cmap[match[v]] = nc;
+            nc++;
+        }
+    }
+
+    coarse->num_vertices = nc;
+    coarse->xadj = malloc((nc + 1) * sizeof(int));
+    coarse->adjncy = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    coarse->adjwgt = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    coarse->vwgt = malloc((nc > 0 ? nc : 1) * sizeof(int));
+    // position[c] - miejsce krawedzi do c w budowanym wierszu (jesli >= poczatku wiersza)
+    int *position = order;
+    if (!coarse->xadj || !coarse->adjncy || !coarse->adjwgt || !coarse->vwgt) {
+        error("Nie udało się zaalokować pamięci dla grafu zgrubionego.\n");
+        free(order);
+        free(match);
+        free_memory(coarse);
+        return NULL;
+    }
+    for (int c = 0; c < nc; c++) {
+        position[c] = -1;
+    }
+
+    int count = 0;
+    coarse->xadj[0] = 0;
+    for (int v = 0; v < n; v++) {
+        if (v > match[v]) {
+            continue;
+        }
+        int c = cmap[v];
+        int row_start = count;
+        int members[2] = {v, match[v]};
+        int num_members = match[v] == v ? 1 : 2;
+        coarse->vwgt[c] = 0;
+        for (int m = 0; m < num_members; m++) {
+            int fine = members[m];
+            coarse->vwgt[c] += vertex_weight(graph, fine);
+            for (int j = graph->xadj[fine]; j < graph->xadj[fine + 1]; j++) {
+                int target = cmap[graph->adjncy[j]];
+                int weight = graph->adjwgt ? graph->adjwgt[j] : 1;
+                if (target == c) {
+                    continue;
+                }
+                if (position[target] < row_start) {
+                    position[target] = count;
+                    coarse->adjncy[count] = target;
+                    coarse->adjwgt[count] = weight;
+                    count++;
+                } else {
+                    coarse->adjwgt[position[target]] += weight;
+                }
+            }
+        }
+        coarse->xadj[c + 1] = count;
+    }
+    coarse->num_edges = count / 2;
+
+    int *shrunk = realloc(coarse->adjncy, (count > 0 ? count : 1) * sizeof(int));
+    if (shrunk) {
+        coarse->adjncy = shrunk;
+    }
+    shrunk = realloc(coarse->adjwgt, (count > 0 ? count : 1) * sizeof(int));
+    if (shrunk) {
+        coarse->adjwgt = shrunk;
+    }
+
+    free(order);
+    free(match);
+    return coarse;
+}
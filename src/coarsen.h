@@ -0,0 +1,8 @@
+#ifndef COARSEN_H
+#define COARSEN_H
+#include "graph.h"
+
+int total_vertex_weight(Graph *graph);
+Graph *coarsen_graph(Graph *graph, int *cmap, int max_vertex_weight);
+
+#endif
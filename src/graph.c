@@ -2,54 +2,156 @@
 #include "log_utils.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-SparseMatrix *create_adjacency_matrix(Graph *graph) {
-    SparseMatrix *matrix = malloc(sizeof(SparseMatrix));
-    if (!matrix) {
-        error("Nie udało się zaalokować pamięci dla SparseMatrix.\n");
-        return NULL;
-    }
+int compare_ints(const void *a, const void *b) { return (*(int *)a - *(int *)b); }
 
-    matrix->rows = graph->num_vertices;
-    matrix->cols = graph->num_vertices;
-    matrix->nnz = graph->num_edges;
+// sortowanie przez wstawianie - listy sasiadow w siatkach sa krotkie
+static void sort_row(int *row, int size) {
+    if (size > 32) {
+        qsort(row, size, sizeof(int), compare_ints);
+        return;
+    }
+    for (int i = 1; i < size; i++) {
+        int value = row[i];
+        int j = i - 1;
+        while (j >= 0 && row[j] > value) {
+            row[j + 1] = row[j];
+            j--;
+        }
+        row[j + 1] = value;
+    }
+}
 
-    matrix->values = malloc(matrix->nnz * sizeof(double));
-    matrix->col_indices = malloc(matrix->nnz * sizeof(int));
-    matrix->row_ptr = malloc((matrix->rows + 1) * sizeof(int));
+// Zamienia wczytana (skierowana) liste sasiedztwa na graf nieskierowany:
+// kazda krawedz w obu kierunkach, posortowane wiersze, bez powtorzen i petli.
+// Krawedzie sa rozrzucane od razu do wierszy wynikowych (sortowanie przez
+// zliczanie po wierszach), a potem kazdy wiersz jest sortowany i scalany.
+int symmetrize_graph(Graph *graph) {
+    int num_vertices = graph->num_vertices;
+    int *xadj = graph->xadj;
+    int *adjncy = graph->adjncy;
+
+    int *sym_xadj = calloc(num_vertices + 1, sizeof(int));
+    int *cursor = malloc((num_vertices > 0 ? num_vertices : 1) * sizeof(int));
+    if (!sym_xadj || !cursor) {
+        error("Nie udało się zaalokować pamięci dla symetrycznej macierzy sąsiedztwa.\n");
+        free(sym_xadj);
+        free(cursor);
+        return 0;
+    }
 
-    if (!matrix->values || !matrix->col_indices || !matrix->row_ptr) {
-        error("Nie udało się zaalokować pamięci dla elementów macierzy.\n");
-        free(matrix->values);
-        free(matrix->col_indices);
-        free(matrix->row_ptr);
-        free(matrix);
-        return NULL;
+    int invalid_vertex = -1;
+#pragma omp parallel for schedule(static)
+    for (int v = 0; v < num_vertices; v++) {
+        for (int j = xadj[v]; j < xadj[v + 1]; j++) {
+            int u = adjncy[j];
+            if (u < 0 || u >= num_vertices) {
+#pragma omp atomic write
+                invalid_vertex = v;
+                continue;
+            }
+            if (u == v) {
+                continue;
+            }
+#pragma omp atomic
+            sym_xadj[v + 1]++;
+#pragma omp atomic
+            sym_xadj[u + 1]++;
+        }
+    }
+    if (invalid_vertex >= 0) {
+        error("Nieprawidłowy sąsiad wierzchołka %d.\n", invalid_vertex);
+        free(sym_xadj);
+        free(cursor);
+        return 0;
     }
 
-    int edge_index = 0;
-    matrix->row_ptr[0] = 0;
+    for (int v = 0; v < num_vertices; v++) {
+        sym_xadj[v + 1] += sym_xadj[v];
+    }
+    int *sym_adjncy = malloc((sym_xadj[num_vertices] > 0 ? sym_xadj[num_vertices] : 1) *
+                             sizeof(int));
+    if (!sym_adjncy) {
+        error("Nie udało się zaalokować pamięci dla symetrycznej macierzy sąsiedztwa.\n");
+        free(sym_xadj);
+        free(cursor);
+        return 0;
+    }
+    memcpy(cursor, sym_xadj, num_vertices * sizeof(int));
+
+#pragma omp parallel for schedule(static)
+    for (int v = 0; v < num_vertices; v++) {
+        for (int j = xadj[v]; j < xadj[v + 1]; j++) {
+            int u = adjncy[j];
+            if (u == v) {
+                continue;
+            }
+            int pos_v, pos_u;
+#pragma omp atomic capture
+            pos_v = cursor[v]++;
+#pragma omp atomic capture
+            pos_u = cursor[u]++;
+            sym_adjncy[pos_v] = u;
+            sym_adjncy[pos_u] = v;
+        }
+    }
 
-    for (int i = 0; i < graph->num_vertices; i++) {
-        // printf("debug: group_sizes[%d] = %d\n", i, graph->group_sizes[i]);
+    // sortowanie i usuwanie powtorzen w kazdym wierszu; nowa dlugosc wiersza
+    // trafia do cursor
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (int v = 0; v < num_vertices; v++) {
+        int *row = sym_adjncy + sym_xadj[v];
+        int size = sym_xadj[v + 1] - sym_xadj[v];
+        sort_row(row, size);
+        int unique = 0;
+        for (int j = 0; j < size; j++) {
+            if (unique == 0 || row[j] != row[unique - 1]) {
+                row[unique++] = row[j];
+            }
+        }
+        cursor[v] = unique;
+    }
 
-        for (int j = 0; j < graph->group_sizes[i]; j++) {
-            int col = graph->edge_groups[i][j];
+    // scalenie wierszy - zapis nigdy nie wyprzedza odczytu
+    int write = 0;
+    for (int v = 0; v < num_vertices; v++) {
+        int start = sym_xadj[v];
+        sym_xadj[v] = write;
+        memmove(sym_adjncy + write, sym_adjncy + start, cursor[v] * sizeof(int));
+        write += cursor[v];
+    }
+    sym_xadj[num_vertices] = write;
+    int *temp = realloc(sym_adjncy, (write > 0 ? write : 1) * sizeof(int));
+    if (temp) {
+        sym_adjncy = temp;
+    }
 
-            if (col < 0 || col >= graph->num_vertices) {
-                error("Nieprawidłowy rozmiar kolumny %d dla wierzchołka "
-                      "%d\n",
-                      col, i);
-                free_sparse_matrix(matrix);
-                return NULL;
-            }
+    free(cursor);
+    free(graph->xadj);
+    free(graph->adjncy);
+    graph->xadj = sym_xadj;
+    graph->adjncy = sym_adjncy;
+    graph->num_edges = write / 2;
+    return 1;
+}
 
-            matrix->col_indices[edge_index] = col;
-            matrix->values[edge_index] = 1.0;
-            edge_index++;
-        }
-        matrix->row_ptr[i + 1] = edge_index;
+// symetryczna macierz sasiedztwa bez kopiowania - wiersze i kolumny wskazuja
+// na xadj i adjncy grafu, values == NULL oznacza same jedynki
+SparseMatrix *create_adjacency_view(Graph *graph) {
+    SparseMatrix *matrix = calloc(1, sizeof(SparseMatrix));
+    if (!matrix) {
+        error("Nie udało się zaalokować pamięci dla SparseMatrix.\n");
+        return NULL;
     }
+
+    matrix->rows = graph->num_vertices;
+    matrix->cols = graph->num_vertices;
+    matrix->nnz = graph->xadj[graph->num_vertices];
+    matrix->values = NULL;
+    matrix->col_indices = graph->adjncy;
+    matrix->row_ptr = graph->xadj;
+    matrix->is_view = 1;
     return matrix;
 }
 
@@ -57,7 +159,7 @@ void print_sparse_matrix(SparseMatrix *matrix) {
     info("Wartości niezerowych elementów:\n");
     info("");
     for (int i = 0; i < matrix->nnz; i++) {
-        printf("%f ", matrix->values[i]);
+        printf("%f ", matrix->values ? matrix->values[i] : 1.0);
     }
     printf("\n\n");
 
@@ -95,7 +197,7 @@ void print_dense_matrix(SparseMatrix *matrix) {
         }
 
         for (int j = start; j < end; j++) {
-            row[matrix->col_indices[j]] = matrix->values[j];
+            row[matrix->col_indices[j]] = matrix->values ? matrix->values[j] : 1.0;
         }
 
         for (int j = 0; j < matrix->cols; j++) {
@@ -108,6 +210,10 @@ void print_dense_matrix(SparseMatrix *matrix) {
 
 void free_sparse_matrix(SparseMatrix *matrix) {
     if (matrix) {
+        if (matrix->is_view) {
+            free(matrix);
+            return;
+        }
         free(matrix->values);
         free(matrix->col_indices);
         free(matrix->row_ptr);
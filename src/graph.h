@@ -1,5 +1,6 @@
 #ifndef GRAPH_H
 #define GRAPH_H
+#include <stddef.h>
 
 typedef struct {
     int num_vertices;  // Liczba wierzcholkow
@@ -7,11 +8,14 @@ typedef struct {
     int *row;          // Wiersz, w ktorym znajduje sie dany wierzcholek
     int *col;          // Kolumna, w ktorej znajduje sie dany wierzcholek
     int max_row_nodes; // Maksymalna liczba wezlow w wierszu
-    int **edge_groups; // Grupy wezlow polaczonych krawedziami
-    int *group_ptr;    // Wskazniki na poczatki grup
     int num_groups;    // Liczba grup
-    int *group_sizes;  // Liczba krawedzi w kazdej grupie, niekoniecznie
-                       // potrzebne bo info jest w edge_groups
+    int *xadj;         // Poczatki list sasiadow w adjncy (num_vertices + 1)
+    int *adjncy;       // Listy sasiadow, kazda krawedz w obu kierunkach (posortowane w grafie
+                       // wejsciowym, w grafach zgrubionych w dowolnej kolejnosci)
+    int *vwgt;         // Wagi wierzcholkow (NULL - wszystkie rowne 1)
+    int *adjwgt;       // Wagi krawedzi rownolegle do adjncy (NULL - wszystkie rowne 1)
+    void *mapping;     // Zmapowany plik gpbin, na ktory wskazuja tablice grafu
+    size_t mapping_size;
 } Graph;
 
 typedef struct {
@@ -21,9 +25,12 @@ typedef struct {
     double *values;   // Wartosci niezerowych elementow
     int *col_indices; // Indeksy kolumn
     int *row_ptr;     // Wskazniki wierszy
+    int is_view;      // Tablice naleza do grafu i nie sa zwalniane z macierza
 } SparseMatrix;
 
-SparseMatrix *create_adjacency_matrix(Graph *graph);
+int compare_ints(const void *a, const void *b);
+int symmetrize_graph(Graph *graph);
+SparseMatrix *create_adjacency_view(Graph *graph);
 void print_sparse_matrix(SparseMatrix *matrix);
 void free_sparse_matrix(SparseMatrix *matrix);
 void print_dense_matrix(SparseMatrix *matrix);
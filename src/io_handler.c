@@ -1,345 +1,891 @@
 #include "io_handler.h"
 #include "log_utils.h"
+#include <ctype.h>
+#include <fcntl.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define MIN_TOKEN_CAPACITY 16
+#define PARALLEL_PARSE_MIN_BYTES (1 << 20) // krotsze linie parsowane sa w jednym watku
+
+int map_input_file(char *filename, InputBuffer *in) {
+    in->data = NULL;
+    in->size = 0;
+    in->pos = 0;
+    in->is_mapped = 0;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        error("Nie można otworzyć pliku '%s'\n", filename);
+        return 0;
+    }
 
-#define MAX 1000000
-
-int compare_ints(const void *a, const void *b) { return (*(int *)a - *(int *)b); }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+            in->data = data;
+            in->size = (size_t)st.st_size;
+            in->is_mapped = 1;
+            close(fd);
+            return 1;
+        }
+    }
 
-Graph *read_graph_from_file(FILE *file) {
-    if (!file) {
-        error("Nieprawidłowy wskaźnik pliku\n");
-        return NULL;
+    // mmap niedostepny (np. potok) - wczytanie calego pliku duzymi blokami
+    size_t capacity = 1 << 20;
+    char *data = malloc(capacity);
+    if (!data) {
+        error("Nie udało się zaalokować pamięci dla bufora pliku '%s'\n", filename);
+        close(fd);
+        return 0;
     }
+    ssize_t got;
+    while ((got = read(fd, data + in->size, capacity - in->size)) > 0) {
+        in->size += (size_t)got;
+        if (in->size == capacity) {
+            char *temp = realloc(data, capacity * 2);
+            if (!temp) {
+                error("Nie udało się zaalokować pamięci dla bufora pliku '%s'\n", filename);
+                free(data);
+                close(fd);
+                return 0;
+            }
+            data = temp;
+            capacity *= 2;
+        }
+    }
+    close(fd);
+    if (got < 0) {
+        error("Nie udało się odczytać pliku '%s'\n", filename);
+        free(data);
+        return 0;
+    }
+    in->data = data;
+    return 1;
+}
 
-    Graph *graph = malloc(sizeof(Graph));
-    if (!graph) {
-        error("Nie udało się zaalokować pamięci dla grafu\n");
-        return NULL;
+void unmap_input_file(InputBuffer *in) {
+    if (!in || !in->data) {
+        return;
+    }
+    if (in->is_mapped) {
+        munmap((void *)in->data, in->size);
+    } else {
+        free((void *)in->data);
     }
+    in->data = NULL;
+    in->size = 0;
+    in->pos = 0;
+}
 
-    char buffer[MAX];
-    char line2_copy[MAX];
-    char line3_copy[MAX];
-    char line4_copy[MAX];
-    char line5_copy[MAX];
+// parsuje jeden token jak atoi i zatrzymuje sie na ';' albo na koncu linii
+static inline const char *parse_token(const char *p, const char *end, int *value) {
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    unsigned int number = 0;
+    while (p < end && (unsigned char)(*p - '0') < 10) {
+        number = number * 10 + (unsigned int)(*p - '0');
+        p++;
+    }
+    while (p < end && *p != ';') {
+        p++;
+    }
+    *value = negative ? -(int)number : (int)number;
+    return p;
+}
 
-    // max wierzcholkow w wierszu
-    if (fscanf(file, "%d\n", &graph->max_row_nodes) != 1) {
-        free(graph);
-        return NULL; // koniec linii lub blad
+static size_t count_char_scalar(const char *p, size_t n, char c) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        count += (p[i] == c);
     }
+    return count;
+}
 
-    // kolumna w ktorej znajduje sie dany wierzcholek, na razie kopiuje zeby
-    // uzyc jak policze liczbe wierzcholkow
-    if (!fgets(buffer, sizeof(buffer), file)) {
-        free(graph);
-        return NULL;
+#if defined(__x86_64__) || defined(__i386__)
+// liczniki 8-bitowe sumowane (psadbw) co najwyzej co 255 blokow
+__attribute__((target("avx2"))) static size_t count_char_avx2(const char *p, size_t n, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    while (i + 32 <= n) {
+        __m256i acc = _mm256_setzero_si256();
+        for (int block = 0; block < 255 && i + 32 <= n; block++, i += 32) {
+            __m256i chunk = _mm256_loadu_si256((const __m256i *)(p + i));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(chunk, needle));
+        }
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, zero));
     }
-    strcpy(line2_copy, buffer);
-    int num_vertices = 0;
-    for (char *p = buffer; *p; p++) {
-        if (*p == ';') {
-            num_vertices++;
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + count_char_scalar(p + i, n - i, c);
+}
+
+__attribute__((target("sse2"))) static size_t count_char_sse2(const char *p, size_t n, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i total = _mm_setzero_si128();
+    size_t i = 0;
+    while (i + 16 <= n) {
+        __m128i acc = _mm_setzero_si128();
+        for (int block = 0; block < 255 && i + 16 <= n; block++, i += 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)(p + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(chunk, needle));
         }
+        total = _mm_add_epi64(total, _mm_sad_epu8(acc, zero));
     }
-    num_vertices++;
-    graph->num_vertices = num_vertices;
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, total);
+    return lanes[0] + lanes[1] + count_char_scalar(p + i, n - i, c);
+}
+#endif
 
-    // wiersz w ktorym znajduje sie dany wierzcholek
-    if (!fgets(buffer, sizeof(buffer), file)) {
-        free(graph);
-        return NULL;
+// liczy wystapienia znaku wektorowo; wariant wybierany w czasie dzialania
+static size_t count_char(const char *p, size_t n, char c) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) {
+        return count_char_avx2(p, n, c);
     }
-    strcpy(line3_copy, buffer);
+    if (__builtin_cpu_supports("sse2")) {
+        return count_char_sse2(p, n, c);
+    }
+#endif
+    return count_char_scalar(p, n, c);
+}
 
-    // przetworzenie wierszy majac liczbe wierzcholkow
-    graph->row = malloc(graph->num_vertices * sizeof(int));
-    if (!graph->row) {
-        error("Nie udało się zaalokować pamięci dla row.\n");
-        free(graph);
+// Dluga linia dzielona jest na fragmenty konczace sie zaraz po ';'. Watki
+// najpierw wektorowo licza ';' w swoich fragmentach, co po sumach
+// prefiksowych daje miejsce kazdego fragmentu w wyniku, a potem parsuja
+// fragmenty bezposrednio do jednej tablicy o dokladnym rozmiarze.
+static int *parse_int_range_parallel(const char *p, const char *end, int num_chunks, int *count) {
+    size_t length = (size_t)(end - p);
+    const char **bounds = malloc((num_chunks + 1) * sizeof(char *));
+    size_t *offsets = malloc((num_chunks + 1) * sizeof(size_t));
+    if (!bounds || !offsets) {
+        error("Nie udało się zaalokować pamięci dla podziału linii.\n");
+        free(bounds);
+        free(offsets);
         return NULL;
     }
-    char *row_token = strtok(line3_copy, ";");
-    int prev_position = atoi(row_token);
-    int curr_position;
-    row_token = strtok(NULL, ";");
-    int current_row = 0;
 
-    for (int v = 0; v < graph->num_vertices;) {
-        if (!row_token) {
-            break;
+    bounds[0] = p;
+    bounds[num_chunks] = end;
+    for (int c = 1; c < num_chunks; c++) {
+        const char *b = p + length / num_chunks * c;
+        if (b < bounds[c - 1]) {
+            b = bounds[c - 1];
         }
+        const char *semicolon = memchr(b, ';', (size_t)(end - b));
+        bounds[c] = semicolon ? semicolon + 1 : end;
+    }
 
-        curr_position = atoi(row_token);
-        row_token = strtok(NULL, ";");
+    // ostatni token linii (bez ';' za nim) nalezy do pierwszego fragmentu
+    // siegajacego konca linii
+    int tail_chunk = 0;
+    while (bounds[tail_chunk + 1] != end) {
+        tail_chunk++;
+    }
 
-        if (curr_position == prev_position) {
-            current_row++;
-            prev_position = curr_position;
-            continue;
-        }
+    offsets[0] = 0;
+#pragma omp parallel for schedule(static)
+    for (int c = 0; c < num_chunks; c++) {
+        offsets[c + 1] = count_char(bounds[c], (size_t)(bounds[c + 1] - bounds[c]), ';') +
+                         (c == tail_chunk);
+    }
+    for (int c = 0; c < num_chunks; c++) {
+        offsets[c + 1] += offsets[c];
+    }
 
-        for (int i = prev_position; i < curr_position && v < graph->num_vertices; i++, v++) {
-            graph->row[i] = current_row;
-        }
+    size_t total = offsets[num_chunks];
+    int *values = malloc((total > 0 ? total : 1) * sizeof(int));
+    if (!values) {
+        error("Nie udało się zaalokować pamięci dla %zu liczb.\n", total);
+        free(bounds);
+        free(offsets);
+        return NULL;
+    }
 
-        prev_position = curr_position;
-        current_row++;
+#pragma omp parallel for schedule(static)
+    for (int c = 0; c < num_chunks; c++) {
+        const char *q = bounds[c];
+        for (size_t t = offsets[c]; t < offsets[c + 1]; t++) {
+            q = parse_token(q, bounds[c + 1], &values[t]) + 1; // pomin ';'
+        }
     }
 
-    // majac liczbe wierzcholkow mozna przetworzyc kolumny
-    graph->col = malloc(graph->num_vertices * sizeof(int));
-    if (!graph->col) {
-        error("Nie udało się zaalokować pamięci dla col.\n");
-        free(graph->row);
-        free(graph);
+    free(bounds);
+    free(offsets);
+    *count = (int)total;
+    return values;
+}
+
+// parsuje linie liczb rozdzielonych ';' bezposrednio do nowej tablicy, bez
+// limitu dlugosci linii; ustawia in->pos na poczatek nastepnej linii
+static int *parse_int_line(InputBuffer *in, int *count) {
+    if (in->pos >= in->size) {
         return NULL;
     }
-    char *tok = strtok(line2_copy, ";");
-    int vertex_idx = 0;
-    while (tok != NULL && vertex_idx < graph->num_vertices) {
-        graph->col[vertex_idx++] = atoi(tok);
-        tok = strtok(NULL, ";");
+    const char *p = in->data + in->pos;
+    const char *newline = memchr(p, '\n', in->size - in->pos);
+    const char *end = newline ? newline : in->data + in->size;
+    in->pos = newline ? (size_t)(newline - in->data) + 1 : in->size;
+
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+    if (num_threads > 1 && end - p >= PARALLEL_PARSE_MIN_BYTES) {
+        return parse_int_range_parallel(p, end, num_threads, count);
     }
 
-    // linia 4
-    if (!fgets(buffer, sizeof(buffer), file)) {
-        free(graph->col);
-        free(graph->row);
-        free(graph);
+    // kazdy token (poza pustymi) zajmuje co najmniej dwa znaki razem z ';'
+    size_t capacity = (size_t)(end - p) / 2 + 1;
+    if (capacity < MIN_TOKEN_CAPACITY) {
+        capacity = MIN_TOKEN_CAPACITY;
+    }
+    int *values = malloc(capacity * sizeof(int));
+    if (!values) {
+        error("Nie udało się zaalokować pamięci dla %zu liczb.\n", capacity);
         return NULL;
     }
 
-    int count = 0;
-    for (char *p = buffer; *p; p++) {
-        if (*p == ';') {
-            count++;
+    size_t n = 0;
+    for (;;) {
+        if (n == capacity) {
+            int *temp = realloc(values, capacity * 2 * sizeof(int));
+            if (!temp) {
+                error("Nie udało się zaalokować pamięci dla %zu liczb.\n", capacity * 2);
+                free(values);
+                return NULL;
+            }
+            values = temp;
+            capacity *= 2;
+        }
+        p = parse_token(p, end, &values[n++]);
+        if (p >= end) {
+            break;
         }
+        p++; // pomin ';'
     }
-    count++;
-    strcpy(line4_copy, buffer);
 
-    // linia 5
-    if (!fgets(buffer, sizeof(buffer), file)) {
-        free(graph->col);
-        free(graph->row);
-        free(graph);
-        return NULL;
+    if (n < capacity) {
+        int *temp = realloc(values, n * sizeof(int));
+        if (temp) {
+            values = temp;
+        }
     }
-    strcpy(line5_copy, buffer);
+    *count = (int)n;
+    return values;
+}
 
-    int group_count = 1;
-    for (char *p = buffer; *p; p++) {
-        if (*p == ';') {
-            group_count++;
-        }
+// odpowiednik fscanf("%d\n"): liczba i wszystkie nastepujace po niej biale znaki
+static int parse_header_int(InputBuffer *in, int *value) {
+    const char *p = in->data + in->pos;
+    const char *end = in->data + in->size;
+    while (p < end && isspace((unsigned char)*p)) {
+        p++;
     }
-    graph->num_groups = group_count;
+    if (p >= end || !(isdigit((unsigned char)*p) || *p == '-' || *p == '+')) {
+        return 0;
+    }
+    const char *line_end = memchr(p, '\n', (size_t)(end - p));
+    p = parse_token(p, line_end ? line_end : end, value);
+    while (p < end && isspace((unsigned char)*p)) {
+        p++;
+    }
+    in->pos = (size_t)(p - in->data);
+    return 1;
+}
 
-    graph->group_ptr = malloc((graph->num_groups + 1) * sizeof(int));
-    if (!graph->group_ptr) {
-        error("Nie udało się alokować pamięci dla group_ptr.\n");
-        free(graph->col);
-        free(graph->row);
-        free(graph);
+Graph *read_graph_from_buffer(InputBuffer *in) {
+    if (!in || !in->data) {
+        error("Nieprawidłowy bufor wejściowy\n");
         return NULL;
     }
 
-    char *token = strtok(line5_copy, ";");
-    int group_idx = 0;
-    while (token != NULL && group_idx < graph->num_groups) {
-        graph->group_ptr[group_idx++] = atoi(token);
-        token = strtok(NULL, ";");
+    Graph *graph = calloc(1, sizeof(Graph));
+    if (!graph) {
+        error("Nie udało się zaalokować pamięci dla grafu\n");
+        return NULL;
     }
 
-    graph->edge_groups = malloc(graph->num_vertices * sizeof(int *));
-    if (!graph->edge_groups) {
-        error("Nie udało się alokować pamięci dla edge_groups.\n");
-        free(graph->group_ptr);
-        free(graph->col);
-        free(graph->row);
+    int *row_ptr = NULL;
+    int *edge_tokens = NULL;
+    int *group_ptr = NULL;
+    int row_count = 0;
+    int edge_count = 0;
+
+    // max wierzcholkow w wierszu
+    if (!parse_header_int(in, &graph->max_row_nodes)) {
         free(graph);
-        return NULL;
+        return NULL; // koniec danych lub blad
     }
 
-    graph->group_sizes = malloc(graph->num_vertices * sizeof(int));
-    if (!graph->group_sizes) {
-        error("Nie udało się alokować pamięci dla group_sizes.\n");
-        free(graph->edge_groups);
-        free(graph->group_ptr);
-        free(graph->col);
-        free(graph->row);
-        free(graph);
-        return NULL;
+    // kolumna w ktorej znajduje sie dany wierzcholek - liczba tokenow to
+    // liczba wierzcholkow
+    graph->col = parse_int_line(in, &graph->num_vertices);
+    if (!graph->col) {
+        goto fail;
     }
 
-    token = strtok(line4_copy, ";");
-    graph->num_edges = 0;
-    int k = 0;
-
-    for (int i = 0; i < graph->num_vertices; i++) {
-        if (k < graph->num_groups && atoi(token) == i) { // sprawdza czy pierwszy token jest rowny
-                                                         // indeksowi wierzcholka
-            int start_idx = (k < graph->num_groups) ? graph->group_ptr[k] : 0;
-            int end_idx = (k < graph->num_groups - 1) ? graph->group_ptr[k + 1] : count;
-
-            graph->group_sizes[i] = (end_idx > start_idx) ? (end_idx - start_idx - 1) : 0;
-            graph->num_edges += graph->group_sizes[i];
-
-            if (graph->group_sizes[i] > 0) {
-                graph->edge_groups[i] = malloc(graph->group_sizes[i] * sizeof(int));
-                if (!graph->edge_groups[i]) {
-                    error("Nie udało się alokować pamięci dla "
-                          "edge_groups[%d]\n",
-                          i);
-                    for (int j = 0; j < i; j++) {
-                        if (graph->edge_groups[j]) {
-                            free(graph->edge_groups[j]);
-                        }
-                    }
-                    free(graph->edge_groups);
-                    free(graph->group_sizes);
-                    free(graph->group_ptr);
-                    free(graph->col);
-                    free(graph->row);
-                    free(graph);
-                    return NULL;
-                }
-            } else {
-                graph->edge_groups[i] = NULL;
-            }
+    // wskazniki poczatkow kolejnych wierszy
+    row_ptr = parse_int_line(in, &row_count);
+    if (!row_ptr) {
+        goto fail;
+    }
 
-            token = strtok(NULL,
-                           ";"); // pomin pierwszy elemnent (bo to indeks wierzcholka)
-            for (int j = 0; j < graph->group_sizes[i]; j++) {
-                if (token == NULL) {
-                    error("Niespodziewany koniec bufora line4_copy podczas "
-                          "prztwarzania edge_groups.\n");
-                    for (int k = 0; k <= i; k++) {
-                        if (graph->edge_groups[k]) {
-                            free(graph->edge_groups[k]);
-                        }
-                    }
-                    free(graph->edge_groups);
-                    free(graph->group_sizes);
-                    free(graph->group_ptr);
-                    free(graph->col);
-                    free(graph->row);
-                    free(graph);
-                    return NULL;
-                }
-                graph->edge_groups[i][j] = atoi(token);
-                token = strtok(NULL, ";");
+    graph->row = malloc(graph->num_vertices * sizeof(int));
+    if (!graph->row) {
+        error("Nie udało się zaalokować pamięci dla row.\n");
+        goto fail;
+    }
+    int current_row = 0;
+    for (int r = 1, v = 0; r < row_count && v < graph->num_vertices; r++) {
+        for (int i = row_ptr[r - 1]; i < row_ptr[r] && v < graph->num_vertices; i++, v++) {
+            if (i >= 0 && i < graph->num_vertices) {
+                graph->row[i] = current_row;
             }
-            // sortuje kazda grupe
-            qsort(graph->edge_groups[i], graph->group_sizes[i], sizeof(int), compare_ints);
-            k++;
-        } else {
-            graph->group_sizes[i] = 0;
-            graph->edge_groups[i] = NULL;
         }
+        current_row++;
     }
-    return graph;
-}
+    free(row_ptr);
+    row_ptr = NULL;
 
-Graph **read_multiple_graphs(char *filename, int *num_graphs) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        error("Nie można otworzyć pliku '%s'\n", filename);
-        return NULL;
+    // linia 4 - grupy polaczonych wierzcholkow
+    edge_tokens = parse_int_line(in, &edge_count);
+    if (!edge_tokens) {
+        goto fail;
     }
 
-    Graph **graphs = NULL;
-    int capacity = 5; // poczatkowa pojemnosc
-    *num_graphs = 0;
+    // linia 5 - wskazniki na poczatki grup
+    group_ptr = parse_int_line(in, &graph->num_groups);
+    if (!group_ptr) {
+        goto fail;
+    }
 
-    graphs = malloc(capacity * sizeof(Graph *));
-    if (!graphs) {
-        error("Nie udało się zaalokować pamięci dla tablicy grafów\n");
-        fclose(file);
-        return NULL;
+    // pierwszy przebieg: liczba sasiadow kazdego wierzcholka i kontrola, czy
+    // grupy leza w pliku po kolei (wtedy adjncy powstaje w miejscu tokenow)
+    graph->xadj = calloc(graph->num_vertices + 1, sizeof(int));
+    if (!graph->xadj) {
+        error("Nie udało się alokować pamięci dla xadj.\n");
+        goto fail;
     }
-    Graph *current_graph;
-    while (!feof(file)) {
-        int c = fgetc(file);
-        if (c == EOF) {
-            break;
+    int in_order = 1;
+    int prev_vertex = -1;
+    int prev_end = 0;
+    for (int k = 0; k < graph->num_groups; k++) {
+        int start_idx = group_ptr[k];
+        int end_idx = (k < graph->num_groups - 1) ? group_ptr[k + 1] : edge_count;
+        if (start_idx < 0 || start_idx >= edge_count || end_idx < start_idx ||
+            end_idx > edge_count) {
+            error("Niepoprawny wskaźnik grupy %d: %d.\n", k, start_idx);
+            goto fail;
+        }
+
+        // pierwszy element grupy to indeks wierzcholka
+        int v = edge_tokens[start_idx];
+        if (v < 0 || v >= graph->num_vertices) {
+            error("Niepoprawny wierzchołek %d na początku grupy %d.\n", v, k);
+            goto fail;
+        }
+        graph->xadj[v + 1] += end_idx - start_idx - 1;
+        in_order = in_order && v > prev_vertex && start_idx >= prev_end;
+        prev_vertex = v;
+        prev_end = end_idx;
+    }
+    for (int v = 0; v < graph->num_vertices; v++) {
+        graph->xadj[v + 1] += graph->xadj[v];
+    }
+    graph->num_edges = graph->xadj[graph->num_vertices];
+
+    if (in_order) {
+        // usuniecie indeksow wierzcholkow z tokenow - zapis nigdy nie
+        // wyprzedza odczytu, wiec wystarczy jedna tablica
+        int write = 0;
+        for (int k = 0; k < graph->num_groups; k++) {
+            int start_idx = group_ptr[k] + 1;
+            int end_idx = (k < graph->num_groups - 1) ? group_ptr[k + 1] : edge_count;
+            memmove(edge_tokens + write, edge_tokens + start_idx,
+                    (end_idx - start_idx) * sizeof(int));
+            write += end_idx - start_idx;
+        }
+        int *temp = realloc(edge_tokens, (write > 0 ? write : 1) * sizeof(int));
+        graph->adjncy = temp ? temp : edge_tokens;
+        edge_tokens = NULL;
+    } else {
+        graph->adjncy = malloc((graph->num_edges > 0 ? graph->num_edges : 1) * sizeof(int));
+        int *cursor = malloc(graph->num_vertices * sizeof(int));
+        if (!graph->adjncy || !cursor) {
+            error("Nie udało się alokować pamięci dla adjncy.\n");
+            free(cursor);
+            goto fail;
         }
+        memcpy(cursor, graph->xadj, graph->num_vertices * sizeof(int));
+        for (int k = 0; k < graph->num_groups; k++) {
+            int start_idx = group_ptr[k];
+            int end_idx = (k < graph->num_groups - 1) ? group_ptr[k + 1] : edge_count;
+            int v = edge_tokens[start_idx];
+            memcpy(graph->adjncy + cursor[v], edge_tokens + start_idx + 1,
+                   (end_idx - start_idx - 1) * sizeof(int));
+            cursor[v] += end_idx - start_idx - 1;
+        }
+        free(cursor);
+    }
+
+    free(group_ptr);
+    group_ptr = NULL;
+    free(edge_tokens);
+    edge_tokens = NULL;
+
+    // graf jest traktowany jako nieskierowany
+    if (!symmetrize_graph(graph)) {
+        goto fail;
+    }
+    return graph;
+
+fail:
+    free(row_ptr);
+    free(group_ptr);
+    free(edge_tokens);
+    free_memory(graph);
+    return NULL;
+}
+
+// pomija biale znaki i komentarze; zwraca 0 gdy w buforze nie ma juz danych
+static int skip_to_next_graph(InputBuffer *in) {
+    while (in->pos < in->size) {
+        char c = in->data[in->pos];
         if (c == '#') {
-            while ((c = fgetc(file)) != EOF && c != '\n')
-                ;
+            const char *newline = memchr(in->data + in->pos, '\n', in->size - in->pos);
+            in->pos = newline ? (size_t)(newline - in->data) + 1 : in->size;
             continue;
         }
         if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            in->pos++;
             continue;
         }
-        ungetc(c, file);
-        current_graph = read_graph_from_file(file);
-        if (current_graph != NULL) {
-            if (*num_graphs >= capacity) {
-                capacity *= 2;
-                Graph **temp = (Graph **)realloc(graphs, capacity * sizeof(Graph *));
-                if (!temp) {
-                    error("Nie udało się zaalokować pamięci dla tablicy "
-                          "grafów\n");
-                    free_multiple_graphs(graphs, *num_graphs);
-                    fclose(file);
-                    return NULL;
-                }
-                graphs = temp;
+        return 1;
+    }
+    return 0;
+}
+
+// szybki przeglad pliku: zapamietuje przesuniecia naglowkow kolejnych grafow
+// bez parsowania ich zawartosci; max_graphs < 0 oznacza brak limitu
+size_t *index_graphs(InputBuffer *in, int max_graphs, int *num_graphs) {
+    *num_graphs = 0;
+    int capacity = 16;
+    size_t *offsets = malloc(capacity * sizeof(size_t));
+    if (!offsets) {
+        error("Nie udało się zaalokować pamięci dla indeksu grafów\n");
+        return NULL;
+    }
+
+    in->pos = 0;
+    while ((max_graphs < 0 || *num_graphs < max_graphs) && skip_to_next_graph(in)) {
+        size_t graph_start = in->pos;
+        int max_row_nodes;
+        if (!parse_header_int(in, &max_row_nodes)) {
+            error("Niepoprawny nagłówek grafu %d (bajt %zu).\n", *num_graphs, graph_start);
+            break;
+        }
+        // 4 linie danych grafu - tylko wyszukanie konca kazdej z nich
+        int lines = 0;
+        while (lines < 4 && in->pos < in->size) {
+            const char *newline = memchr(in->data + in->pos, '\n', in->size - in->pos);
+            in->pos = newline ? (size_t)(newline - in->data) + 1 : in->size;
+            lines++;
+        }
+        if (lines < 4) {
+            error("Niekompletny graf %d (bajt %zu).\n", *num_graphs, graph_start);
+            break;
+        }
+
+        if (*num_graphs >= capacity) {
+            capacity *= 2;
+            size_t *temp = realloc(offsets, capacity * sizeof(size_t));
+            if (!temp) {
+                error("Nie udało się zaalokować pamięci dla indeksu grafów\n");
+                free(offsets);
+                return NULL;
             }
-            graphs[*num_graphs] = current_graph;
-            (*num_graphs)++;
+            offsets = temp;
         }
+        offsets[(*num_graphs)++] = graph_start;
     }
-    fclose(file);
-    if (*num_graphs == 0) {
-        free(graphs);
+    return offsets;
+}
+
+Graph *read_graph_at_index(char *filename, int graph_index, int *num_graphs) {
+    *num_graphs = 0;
+
+    InputBuffer in;
+    if (!map_input_file(filename, &in)) {
         return NULL;
     }
-    if (*num_graphs < capacity) {
-        Graph **temp = (Graph **)realloc(graphs, (*num_graphs) * sizeof(Graph *));
-        if (temp) {
-            graphs = temp;
+
+    // wystarczy dojsc do szukanego grafu; pelna liczba grafow jest potrzebna
+    // tylko wtedy, gdy indeks jest poza zakresem
+    size_t *offsets = index_graphs(&in, graph_index + 1, num_graphs);
+    if (offsets && *num_graphs <= graph_index) {
+        free(offsets);
+        offsets = index_graphs(&in, -1, num_graphs);
+    }
+    if (!offsets) {
+        unmap_input_file(&in);
+        return NULL;
+    }
+
+    Graph *graph = NULL;
+    if (*num_graphs == 0) {
+        error("Plik '%s' nie zawiera żadnego grafu.\n", filename);
+    } else if (graph_index < *num_graphs) {
+        in.pos = offsets[graph_index];
+        struct timespec start, stop;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        graph = read_graph_from_buffer(&in);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        if (!graph) {
+            error("Niepoprawny format grafu %d w pliku '%s'.\n", graph_index, filename);
+        } else {
+            double seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) * 1e-9;
+            double megabytes = (in.pos - offsets[graph_index]) / (1024.0 * 1024.0);
+            verbose("Parsowanie grafu: %.1f MB w %.3f s (%.1f MB/s)\n", megabytes, seconds,
+                    seconds > 0 ? megabytes / seconds : 0.0);
         }
     }
 
-    return graphs;
+    free(offsets);
+    unmap_input_file(&in);
+    return graph;
 }
 
-void free_memory(Graph *graph) {
-    if (graph) {
-        if (graph->edge_groups) {
-            for (int i = 0; i < graph->num_vertices; i++) {
-                if (graph->edge_groups[i]) { // sprawdza czy nie null
-                    free(graph->edge_groups[i]);
-                }
+// Format gpbin (wersja 2): naglowek, a po nim tablice int32 wyrownane do 8
+// bajtow: xadj (V + 1), adjncy (nnz) symetrycznej macierzy sasiedztwa oraz
+// opcjonalnie row (V) i col (V).
+// Suma kontrolna (Fletcher-64) obejmuje naglowek (z wyzerowanym polem sumy)
+// i wszystko za nim.
+#define GPBIN_MAGIC "GPBN"
+#define GPBIN_VERSION 2
+#define GPBIN_FLAG_COORDS 0x1u
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    int32_t num_vertices;
+    int64_t nnz;
+    int32_t max_row_nodes;
+    int32_t reserved;
+    uint64_t checksum;
+} GpbinHeader;
+
+static size_t gpbin_array_size(int64_t count) {
+    return ((size_t)count * sizeof(int32_t) + 7) & ~(size_t)7;
+}
+
+typedef struct {
+    uint64_t sum1;
+    uint64_t sum2;
+} GpbinChecksum;
+
+// Fletcher-64 liczony przyrostowo, zeby kolejne tablice mozna bylo dopisywac
+// bez skladania ich w jeden bufor
+static void gpbin_checksum_update(GpbinChecksum *state, const void *data, size_t size) {
+    const uint32_t *words = data;
+    size_t num_words = size / sizeof(uint32_t);
+
+    // modulo liczone co blok slow, zeby sumy nie przepelnily 64 bitow
+    while (num_words > 0) {
+        size_t block = num_words < 65536 ? num_words : 65536;
+        for (size_t i = 0; i < block; i++) {
+            state->sum1 += words[i];
+            state->sum2 += state->sum1;
+        }
+        state->sum1 %= 0xffffffffu;
+        state->sum2 %= 0xffffffffu;
+        words += block;
+        num_words -= block;
+    }
+}
+
+static uint64_t gpbin_checksum_value(GpbinChecksum *state) {
+    return (state->sum2 << 32) | state->sum1;
+}
+
+// suma zaczyna sie od naglowka z wyzerowanym polem checksum; naglowek jest
+// kopiowany do tablicy slow, ktora czyta gpbin_checksum_update
+static void gpbin_checksum_header(GpbinChecksum *state, const GpbinHeader *header) {
+    uint32_t words[sizeof(GpbinHeader) / sizeof(uint32_t)];
+    size_t checksum_word = offsetof(GpbinHeader, checksum) / sizeof(uint32_t);
+    memcpy(words, header, sizeof(words));
+    words[checksum_word] = 0;
+    words[checksum_word + 1] = 0;
+    gpbin_checksum_update(state, words, sizeof(words));
+}
+
+// zapisuje tablice z dopelnieniem do 8 bajtow i dolicza ja do sumy kontrolnej
+static int write_padded_array(FILE *file, const int *array, int64_t count,
+                              GpbinChecksum *checksum) {
+    static const char padding[8] = {0};
+    size_t bytes = (size_t)count * sizeof(int32_t);
+    size_t pad = gpbin_array_size(count) - bytes;
+    if (count > 0 && fwrite(array, 1, bytes, file) != bytes) {
+        return 0;
+    }
+    if (pad > 0 && fwrite(padding, 1, pad, file) != pad) {
+        return 0;
+    }
+    gpbin_checksum_update(checksum, array, bytes);
+    gpbin_checksum_update(checksum, padding, pad);
+    return 1;
+}
+
+int save_graph_in_gpbin_format(Graph *graph, char *filename) {
+    if (!graph) {
+        error("Niepoprawne dane wejściowe dla save_graph_in_gpbin_format.\n");
+        return 0;
+    }
+
+    int has_coords = graph->row && graph->col;
+    int num_vertices = graph->num_vertices;
+    int64_t nnz = graph->xadj[num_vertices];
+
+    GpbinHeader header = {0};
+    memcpy(header.magic, GPBIN_MAGIC, 4);
+    header.version = GPBIN_VERSION;
+    header.flags = has_coords ? GPBIN_FLAG_COORDS : 0;
+    header.num_vertices = num_vertices;
+    header.nnz = nnz;
+    header.max_row_nodes = graph->max_row_nodes;
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        error("Nie można otworzyć pliku '%s'.\n", filename);
+        return 0;
+    }
+
+    // naglowek jest zapisywany jeszcze raz na koncu, juz z suma kontrolna
+    GpbinChecksum checksum = {0, 0};
+    gpbin_checksum_header(&checksum, &header);
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             write_padded_array(file, graph->xadj, num_vertices + 1, &checksum) &&
+             write_padded_array(file, graph->adjncy, nnz, &checksum);
+    if (ok && has_coords) {
+        ok = write_padded_array(file, graph->row, num_vertices, &checksum) &&
+             write_padded_array(file, graph->col, num_vertices, &checksum);
+    }
+    header.checksum = gpbin_checksum_value(&checksum);
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok) {
+        error("Nie udało się zapisać pliku '%s'.\n", filename);
+        return 0;
+    }
+    info("Udało się zapisać graf w pliku binarnym '%s'.\n", filename);
+    return 1;
+}
+
+// Tablice z pliku sa uzywane w miejscu jako symetryczna macierz sasiedztwa
+// bez petli z posortowanymi wierszami, wiec jeden przebieg sprawdza zakres
+// indeksow, scisle rosnace wiersze (czyli tez brak powtorzen), brak petli
+// oraz symetrie: przy wierszach przegladanych rosnaco sasiedzi u < v w
+// wierszu v musza sie pojawic dokladnie w kolejnosci, w jakiej wiersze u
+// wskazuja na v, wiec cursor[v] przesuwa sie po nich, a po dojsciu do
+// wiersza v musi minac je wszystkie. Wymaga monotonicznego xadj.
+static int validate_gpbin_adjacency(Graph *graph, const char *filename) {
+    int num_vertices = graph->num_vertices;
+    const int *xadj = graph->xadj;
+    const int *adjncy = graph->adjncy;
+    int *cursor = malloc((num_vertices > 0 ? num_vertices : 1) * sizeof(int));
+    if (!cursor) {
+        error("Nie udało się zaalokować pamięci dla sprawdzenia pliku gpbin.\n");
+        return 0;
+    }
+    memcpy(cursor, xadj, num_vertices * sizeof(int));
+
+    for (int v = 0; v < num_vertices; v++) {
+        int lower = 0;
+        for (int j = xadj[v]; j < xadj[v + 1]; j++) {
+            int u = adjncy[j];
+            if (u < 0 || u >= num_vertices) {
+                error("Niepoprawny indeks sąsiada w pliku gpbin '%s'.\n", filename);
+                free(cursor);
+                return 0;
+            }
+            if (u == v) {
+                error("Pętla przy wierzchołku %d w pliku gpbin '%s'.\n", v, filename);
+                free(cursor);
+                return 0;
             }
-            free(graph->edge_groups);
+            if (j > xadj[v] && u <= adjncy[j - 1]) {
+                error("Sąsiedzi wierzchołka %d w pliku gpbin '%s' nie są posortowani "
+                      "rosnąco bez powtórzeń.\n",
+                      v, filename);
+                free(cursor);
+                return 0;
+            }
+            if (u < v) {
+                lower++;
+            } else if (cursor[u] >= xadj[u + 1] || adjncy[cursor[u]] != v) {
+                error("Macierz sąsiedztwa w pliku gpbin '%s' nie jest symetryczna "
+                      "(krawędź %d-%d).\n",
+                      filename, v, u);
+                free(cursor);
+                return 0;
+            } else {
+                cursor[u]++;
+            }
+        }
+        if (cursor[v] - xadj[v] != lower) {
+            error("Macierz sąsiedztwa w pliku gpbin '%s' nie jest symetryczna "
+                  "(wierzchołek %d).\n",
+                  filename, v);
+            free(cursor);
+            return 0;
         }
+    }
+    free(cursor);
+    return 1;
+}
 
-        free(graph->group_sizes);
-        free(graph->group_ptr);
-        free(graph->row);
-        free(graph->col);
-        free(graph);
+Graph *read_graph_from_gpbin(char *filename) {
+    InputBuffer in;
+    if (!map_input_file(filename, &in)) {
+        return NULL;
+    }
+    if (!in.is_mapped) {
+        error("Plik gpbin '%s' musi być zwykłym plikiem.\n", filename);
+        unmap_input_file(&in);
+        return NULL;
+    }
+
+    const GpbinHeader *header = (const GpbinHeader *)in.data;
+    if (in.size < sizeof(GpbinHeader) || memcmp(header->magic, GPBIN_MAGIC, 4) != 0) {
+        error("Plik '%s' nie jest plikiem gpbin.\n", filename);
+        unmap_input_file(&in);
+        return NULL;
+    }
+    if (header->version != GPBIN_VERSION) {
+        error("Nieobsługiwana wersja pliku gpbin: %u.\n", header->version);
+        unmap_input_file(&in);
+        return NULL;
+    }
+
+    int num_vertices = header->num_vertices;
+    int has_coords = (header->flags & GPBIN_FLAG_COORDS) != 0;
+    size_t payload_size = 0;
+    if (num_vertices >= 0 && num_vertices < INT32_MAX && header->nnz >= 0 &&
+        header->nnz <= INT32_MAX) {
+        payload_size = gpbin_array_size(num_vertices + 1) + gpbin_array_size(header->nnz);
+        if (has_coords) {
+            payload_size += 2 * gpbin_array_size(num_vertices);
+        }
     }
+    if (payload_size == 0 || in.size != sizeof(GpbinHeader) + payload_size) {
+        error("Niepoprawny rozmiar pliku gpbin '%s'.\n", filename);
+        unmap_input_file(&in);
+        return NULL;
+    }
+
+    const char *payload = in.data + sizeof(GpbinHeader);
+    GpbinChecksum checksum = {0, 0};
+    gpbin_checksum_header(&checksum, header);
+    gpbin_checksum_update(&checksum, payload, payload_size);
+    if (gpbin_checksum_value(&checksum) != header->checksum) {
+        error("Niepoprawna suma kontrolna pliku gpbin '%s'.\n", filename);
+        unmap_input_file(&in);
+        return NULL;
+    }
+
+    Graph *graph = calloc(1, sizeof(Graph));
+    if (!graph) {
+        error("Nie udało się zaalokować pamięci dla grafu\n");
+        unmap_input_file(&in);
+        return NULL;
+    }
+    graph->mapping = (void *)in.data;
+    graph->mapping_size = in.size;
+    graph->num_vertices = num_vertices;
+    graph->max_row_nodes = header->max_row_nodes;
+
+    // tablice grafu wskazuja bezposrednio na zmapowany plik
+    const char *p = payload;
+    graph->xadj = (int *)p;
+    p += gpbin_array_size(num_vertices + 1);
+    graph->adjncy = (int *)p;
+    p += gpbin_array_size(header->nnz);
+    if (has_coords) {
+        graph->row = (int *)p;
+        p += gpbin_array_size(num_vertices);
+        graph->col = (int *)p;
+    }
+
+    if (graph->xadj[0] != 0 || graph->xadj[num_vertices] != header->nnz) {
+        error("Niepoprawne wskaźniki wierszy w pliku gpbin '%s'.\n", filename);
+        free_memory(graph);
+        return NULL;
+    }
+
+    // suma kontrolna wykrywa tylko uszkodzenie pliku; dalsze etapy indeksuja
+    // przez xadj i adjncy, wiec musza byc one poprawne
+    for (int i = 0; i < num_vertices; i++) {
+        if (graph->xadj[i + 1] < graph->xadj[i]) {
+            error("Niepoprawne wskaźniki wierszy w pliku gpbin '%s'.\n", filename);
+            free_memory(graph);
+            return NULL;
+        }
+        if (graph->xadj[i + 1] > graph->xadj[i]) {
+            graph->num_groups++;
+        }
+    }
+    if (!validate_gpbin_adjacency(graph, filename)) {
+        free_memory(graph);
+        return NULL;
+    }
+    graph->num_edges = (int)(header->nnz / 2);
+
+    return graph;
 }
 
-void free_multiple_graphs(Graph **graphs, int num_graphs) {
-    if (graphs == NULL) {
+void free_memory(Graph *graph) {
+    if (graph && graph->mapping) {
+        // tablice danych naleza do zmapowanego pliku
+        munmap(graph->mapping, graph->mapping_size);
+        free(graph);
         return;
     }
-    for (int i = 0; i < num_graphs; i++) {
-        if (graphs[i] != NULL) {
-            free_memory(graphs[i]);
-        }
+    if (graph) {
+        free(graph->xadj);
+        free(graph->adjncy);
+        free(graph->vwgt);
+        free(graph->adjwgt);
+        free(graph->row);
+        free(graph->col);
+        free(graph);
     }
-    free(graphs);
 }
 
 void save_in_text_file(PartitionResult *result, char *filename) {
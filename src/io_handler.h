@@ -2,12 +2,24 @@
 #define IO_HANDLER_H
 #include "graph.h"
 #include "partitioner.h"
+#include <stddef.h>
 #include <stdio.h>
 
-Graph *read_graph_from_file(FILE *file);
-Graph **read_multiple_graphs(char *filename, int *num_graphs);
+typedef struct {
+    const char *data; // Zawartosc pliku (zmapowana przez mmap albo wczytana)
+    size_t size;      // Rozmiar danych w bajtach
+    size_t pos;       // Aktualna pozycja parsera
+    int is_mapped;    // Czy dane pochodza z mmap (inaczej z malloc)
+} InputBuffer;
+
+int map_input_file(char *filename, InputBuffer *in);
+void unmap_input_file(InputBuffer *in);
+Graph *read_graph_from_buffer(InputBuffer *in);
+size_t *index_graphs(InputBuffer *in, int max_graphs, int *num_graphs);
+Graph *read_graph_at_index(char *filename, int graph_index, int *num_graphs);
+int save_graph_in_gpbin_format(Graph *graph, char *filename);
+Graph *read_graph_from_gpbin(char *filename);
 void free_memory(Graph *graph);
-void free_multiple_graphs(Graph **graphs, int num_graphs);
 void save_in_text_file(PartitionResult *result, char *filename);
 void save_in_binary_file(PartitionResult *result, char *filename);
 void save_in_csrrg_format(PartitionResult *result, Graph *graph, char *filename);
@@ -1,10 +1,35 @@
 #include "kmeans.h"
 #include "log_utils.h"
 #include <float.h>
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-double squared_distance(double *point1, double *point2, int num_features) {
+#define KMEANS_MAX_ITERATIONS 100
+#define KMEANS_PARALLEL_ROUNDS 5      // rundy nadprobkowania w k-means||
+#define KMEANS_PARALLEL_OVERSAMPLING 2 // oczekiwana liczba kandydatow na runde wzgledem k
+#define KMEANS_BOUND_SLACK 1e-9       // wzgledny zapas granic odleglosci na bledy zaokraglen
+#define KMEANS_CHUNKS 64              // stala liczba fragmentow punktow przy sumach czesciowych
+#define KMEANS_MIN_PARALLEL_POINTS 4096 // ponizej tej liczby punktow petle sa sekwencyjne
+
+// Bufory jednego wywolania kmeans_clustering. Sumy czesciowe sa liczone dla
+// KMEANS_CHUNKS stalych fragmentow punktow i dodawane w kolejnosci
+// fragmentow, wiec wynik nie zalezy od liczby watkow.
+typedef struct {
+    double *partial_sums; // KMEANS_CHUNKS x k x dim
+    int *partial_counts;  // KMEANS_CHUNKS x k
+    int *cluster_sizes;   // k
+} KmeansWorkspace;
+
+// zakres punktow [begin, end) fragmentu chunk
+static inline void chunk_range(int n, int chunk, int *begin, int *end) {
+    *begin = (int)((long long)n * chunk / KMEANS_CHUNKS);
+    *end = (int)((long long)n * (chunk + 1) / KMEANS_CHUNKS);
+}
+
+double squared_distance(const double *point1, const double *point2, int num_features) {
     double distance = 0.0;
 
     for (int i = 0; i < num_features; i++) {
@@ -15,99 +40,660 @@ double squared_distance(double *point1, double *point2, int num_features) {
     return distance;
 }
 
-int *kmeans_clustering(double **spectral_points, int num_vertices, int num_eigenvectors,
-                       int num_parts) {
-    int *labels = malloc(num_vertices * sizeof(int));
-    double **centroids = malloc(num_parts * sizeof(double *));
-
-    if (!centroids) {
-        error("Nie udało się alokować pamięci dla centroidów.\n");
-        free(labels);
-        return NULL;
+// najblizszy centroid; przy rownych odleglosciach ten o nizszym indeksie
+static int nearest_centroid(const double *point, const double *centroids, int k, int dim) {
+    double min_distance = DBL_MAX;
+    int best_cluster = 0;
+    for (int c = 0; c < k; c++) {
+        double distance = squared_distance(point, centroids + (size_t)c * dim, dim);
+        if (distance < min_distance) {
+            min_distance = distance;
+            best_cluster = c;
+        }
     }
+    return best_cluster;
+}
 
-    for (int i = 0; i < num_parts; i++) {
-        centroids[i] = calloc(num_eigenvectors, sizeof(double));
+// d2[i] = min(d2[i], |x_i - center|^2); zwraca sume d2
+static double update_min_distances(const double *points, int n, int dim, const double *center,
+                                   const double *weights, double *d2) {
+    double partial[KMEANS_CHUNKS];
+#pragma omp parallel for schedule(static) if (n >= KMEANS_MIN_PARALLEL_POINTS)
+    for (int chunk = 0; chunk < KMEANS_CHUNKS; chunk++) {
+        int begin, end;
+        chunk_range(n, chunk, &begin, &end);
+        double sum = 0.0;
+        for (int i = begin; i < end; i++) {
+            double distance = squared_distance(points + (size_t)i * dim, center, dim);
+            if (distance < d2[i]) {
+                d2[i] = distance;
+            }
+            sum += weights ? weights[i] * d2[i] : d2[i];
+        }
+        partial[chunk] = sum;
+    }
+    double total = 0.0;
+    for (int chunk = 0; chunk < KMEANS_CHUNKS; chunk++) {
+        total += partial[chunk];
+    }
+    return total;
+}
 
-        if (!centroids[i]) {
-            error("Nie udało się alokować pamięci dla centroidu %d.\n", i);
-            for (int j = 0; j < i; j++) {
-                free(centroids[j]);
+// indeks wylosowany z prawdopodobienstwem proporcjonalnym do weights[i] * d2[i]
+static int sample_proportional(const double *d2, const double *weights, int n, double total,
+                               RngState *rng) {
+    double target = rng_double(rng) * total;
+    int last = 0;
+    for (int i = 0; i < n; i++) {
+        double mass = weights ? weights[i] * d2[i] : d2[i];
+        if (mass > 0.0) {
+            last = i;
+            target -= mass;
+            if (target < 0.0) {
+                return i;
             }
-            free(centroids);
-            free(labels);
-            return NULL;
         }
     }
+    return last;
+}
 
-    for (int i = 0; i < num_vertices; i++) {
-        labels[i] = -1;
+// k-means++ (Arthur, Vassilvitskii): kolejne centroidy losowane z
+// prawdopodobienstwem proporcjonalnym do kwadratu odleglosci od najblizszego
+// juz wybranego (opcjonalnie razy waga punktu). Zwraca liczbe wybranych
+// centroidow - mniej niz k, gdy roznych punktow jest mniej niz k.
+static int seed_kmeanspp(const double *points, const double *weights, int n, int dim, int k,
+                         RngState *rng, double *centroids, double *d2) {
+    for (int i = 0; i < n; i++) {
+        d2[i] = DBL_MAX;
+    }
+    int first = rng_int(rng, n);
+    memcpy(centroids, points + (size_t)first * dim, dim * sizeof(double));
+    double total = update_min_distances(points, n, dim, centroids, weights, d2);
+    int chosen = 1;
+    while (chosen < k && total > 0.0) {
+        int index = sample_proportional(d2, weights, n, total, rng);
+        double *centroid = centroids + (size_t)chosen * dim;
+        memcpy(centroid, points + (size_t)index * dim, dim * sizeof(double));
+        total = update_min_distances(points, n, dim, centroid, weights, d2);
+        chosen++;
     }
+    return chosen;
+}
 
-    for (int i = 0; i < num_parts; i++) {
-        int random_index = rand() % num_vertices;
-        for (int j = 0; j < num_eigenvectors; j++) {
-            centroids[i][j] = spectral_points[random_index][j];
+// Wybor najdalszych punktow (Gonzalez): pierwszy centroid jest losowy, a
+// kazdy nastepny to punkt najdalszy od dotychczas wybranych, bez losowania
+static int seed_farthest(const double *points, int n, int dim, int k, RngState *rng,
+                         double *centroids, double *d2) {
+    for (int i = 0; i < n; i++) {
+        d2[i] = DBL_MAX;
+    }
+    int first = rng_int(rng, n);
+    memcpy(centroids, points + (size_t)first * dim, dim * sizeof(double));
+    update_min_distances(points, n, dim, centroids, NULL, d2);
+    int chosen = 1;
+    while (chosen < k) {
+        int farthest = 0;
+        for (int i = 1; i < n; i++) {
+            if (d2[i] > d2[farthest]) {
+                farthest = i;
+            }
         }
+        if (d2[farthest] == 0.0) {
+            break;
+        }
+        double *centroid = centroids + (size_t)chosen * dim;
+        memcpy(centroid, points + (size_t)farthest * dim, dim * sizeof(double));
+        update_min_distances(points, n, dim, centroid, NULL, d2);
+        chosen++;
     }
+    return chosen;
+}
 
-    int max_iterations = 100;
-    for (int iter = 0; iter < max_iterations; iter++) {
-        int converged = 1;
+// k-means|| (Bahmani i in.): w kilku rundach kazdy punkt niezaleznie trafia do
+// kandydatow z prawdopodobienstwem l * d2 / suma, gdzie l = 2k; kandydaci
+// dostaja wagi rowne liczbie najblizszych im punktow, a z nich k-means++
+// wybiera k centroidow. Losowanie w rundzie uzywa osobnego strumienia na
+// punkt, wiec nie zalezy od kolejnosci przegladania punktow.
+static int seed_kmeans_parallel(const double *points, int n, int dim, int k, RngState *rng,
+                                double *centroids, double *d2) {
+    // z zapasem dwukrotnym wzgledem oczekiwanej liczby kandydatow
+    int max_candidates = 1 + 2 * KMEANS_PARALLEL_ROUNDS * KMEANS_PARALLEL_OVERSAMPLING * k;
+    if (max_candidates > n) {
+        max_candidates = n;
+    }
+    int *candidates = malloc(max_candidates * sizeof(int));
+    char *is_candidate = calloc(n, 1);
+    double *candidate_points = NULL;
+    double *candidate_weights = NULL;
+    double *candidate_d2 = NULL;
+    if (!candidates || !is_candidate) {
+        free(candidates);
+        free(is_candidate);
+        return seed_kmeanspp(points, NULL, n, dim, k, rng, centroids, d2);
+    }
 
-        for (int i = 0; i < num_vertices; i++) {
-            double min_distance = DBL_MAX;
-            int best_cluster = -1;
-            for (int c = 0; c < num_parts; c++) {
-                double distance =
-                    squared_distance(spectral_points[i], centroids[c], num_eigenvectors);
+    for (int i = 0; i < n; i++) {
+        d2[i] = DBL_MAX;
+    }
+    int count = 0;
+    candidates[count++] = rng_int(rng, n);
+    is_candidate[candidates[0]] = 1;
+    double total =
+        update_min_distances(points, n, dim, points + (size_t)candidates[0] * dim, NULL, d2);
+    double oversampling = (double)KMEANS_PARALLEL_OVERSAMPLING * k;
 
-                if (distance < min_distance) {
-                    min_distance = distance;
-                    best_cluster = c;
+    for (int round = 0; round < KMEANS_PARALLEL_ROUNDS && total > 0.0; round++) {
+        uint64_t round_key = rng_next(rng);
+        int round_start = count;
+        // 2 - punkt wylosowany w tej rundzie
+#pragma omp parallel for schedule(static) if (n >= KMEANS_MIN_PARALLEL_POINTS)
+        for (int i = 0; i < n; i++) {
+            if (is_candidate[i]) {
+                continue;
+            }
+            RngState point_rng;
+            rng_init(&point_rng, round_key, i);
+            if (rng_double(&point_rng) * total < oversampling * d2[i]) {
+                is_candidate[i] = 2;
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            if (is_candidate[i] == 2) {
+                if (count < max_candidates) {
+                    candidates[count++] = i;
+                    is_candidate[i] = 1;
+                } else {
+                    is_candidate[i] = 0;
                 }
             }
+        }
+        total = 0.0;
+        for (int c = round_start; c < count; c++) {
+            total = update_min_distances(points, n, dim, points + (size_t)candidates[c] * dim,
+                                         NULL, d2);
+        }
+        if (round_start == count) {
+            break;
+        }
+    }
+
+    candidate_points = malloc((size_t)count * dim * sizeof(double));
+    candidate_weights = calloc(count, sizeof(double));
+    candidate_d2 = malloc(count * sizeof(double));
+    if (!candidate_points || !candidate_weights || !candidate_d2) {
+        free(candidates);
+        free(is_candidate);
+        free(candidate_points);
+        free(candidate_weights);
+        free(candidate_d2);
+        return seed_kmeanspp(points, NULL, n, dim, k, rng, centroids, d2);
+    }
+    for (int c = 0; c < count; c++) {
+        memcpy(candidate_points + (size_t)c * dim, points + (size_t)candidates[c] * dim,
+               dim * sizeof(double));
+    }
+    // wagi kandydatow; najblizszy kandydat trafia do d2 jako indeks, zeby
+    // petla po punktach byla rownolegla, a zliczanie w kolejnosci punktow
+#pragma omp parallel for schedule(static) if (n >= KMEANS_MIN_PARALLEL_POINTS)
+    for (int i = 0; i < n; i++) {
+        d2[i] = nearest_centroid(points + (size_t)i * dim, candidate_points, count, dim);
+    }
+    for (int i = 0; i < n; i++) {
+        candidate_weights[(int)d2[i]] += 1.0;
+    }
+
+    int chosen = seed_kmeanspp(candidate_points, candidate_weights, count, dim, k, rng, centroids,
+                               candidate_d2);
+
+    free(candidates);
+    free(is_candidate);
+    free(candidate_points);
+    free(candidate_weights);
+    free(candidate_d2);
+    return chosen;
+}
+
+// srodki ciezkosci klastrow; pusty klaster dostaje wektor zerowy. Kazdy
+// fragment punktow sumuje do wlasnego bufora, a bufory sa dodawane w
+// kolejnosci fragmentow.
+static void update_centroids(const double *points, int n, int dim, int k, const int *labels,
+                             double *centroids, KmeansWorkspace *ws) {
+    size_t block = (size_t)k * dim;
+#pragma omp parallel for schedule(dynamic, 1) if (n >= KMEANS_MIN_PARALLEL_POINTS)
+    for (int chunk = 0; chunk < KMEANS_CHUNKS; chunk++) {
+        double *sums = ws->partial_sums + chunk * block;
+        int *counts = ws->partial_counts + (size_t)chunk * k;
+        memset(sums, 0, block * sizeof(double));
+        memset(counts, 0, k * sizeof(int));
+        int begin, end;
+        chunk_range(n, chunk, &begin, &end);
+        for (int i = begin; i < end; i++) {
+            int cluster = labels[i];
+            const double *point = points + (size_t)i * dim;
+            double *sum = sums + (size_t)cluster * dim;
+            counts[cluster]++;
+            for (int j = 0; j < dim; j++) {
+                sum[j] += point[j];
+            }
+        }
+    }
+
+#pragma omp parallel for schedule(static) if (n >= KMEANS_MIN_PARALLEL_POINTS)
+    for (int c = 0; c < k; c++) {
+        double *centroid = centroids + (size_t)c * dim;
+        int size = 0;
+        memset(centroid, 0, dim * sizeof(double));
+        for (int chunk = 0; chunk < KMEANS_CHUNKS; chunk++) {
+            const double *sum = ws->partial_sums + chunk * block + (size_t)c * dim;
+            size += ws->partial_counts[(size_t)chunk * k + c];
+            for (int j = 0; j < dim; j++) {
+                centroid[j] += sum[j];
+            }
+        }
+        ws->cluster_sizes[c] = size;
+        if (size > 0) {
+            for (int j = 0; j < dim; j++) {
+                centroid[j] /= size;
+            }
+        }
+    }
+}
+
+// Granica wyklucza zmiane etykiety tylko z zapasem na bledy zaokraglen, zeby
+// przy remisach wynik byl taki sam jak w metodzie Lloyda (najnizszy indeks)
+static inline int bound_excludes(double upper, double lower) {
+    return upper * (1.0 + KMEANS_BOUND_SLACK) < lower;
+}
+
+// przesuniecia centroidow po aktualizacji; zwraca najwieksze i drugie w kolejnosci
+static void centroid_drift(const double *old, const double *centroids, int k, int dim,
+                           double *drift, int *max_cluster, double *max_drift,
+                           double *second_drift) {
+    *max_cluster = 0;
+    *max_drift = 0.0;
+    *second_drift = 0.0;
+    for (int c = 0; c < k; c++) {
+        drift[c] = sqrt(squared_distance(old + (size_t)c * dim, centroids + (size_t)c * dim, dim));
+        if (drift[c] > *max_drift) {
+            *second_drift = *max_drift;
+            *max_drift = drift[c];
+            *max_cluster = c;
+        } else if (drift[c] > *second_drift) {
+            *second_drift = drift[c];
+        }
+    }
+}
 
+// odleglosci miedzy centroidami (k x k) i polowa odleglosci do najblizszego innego
+static void centroid_separation(const double *centroids, int k, int dim, double *between,
+                                double *half_gap) {
+    for (int c = 0; c < k; c++) {
+        between[(size_t)c * k + c] = 0.0;
+        half_gap[c] = DBL_MAX;
+    }
+    for (int c = 0; c < k; c++) {
+        for (int o = c + 1; o < k; o++) {
+            double distance = sqrt(
+                squared_distance(centroids + (size_t)c * dim, centroids + (size_t)o * dim, dim));
+            between[(size_t)c * k + o] = distance;
+            between[(size_t)o * k + c] = distance;
+            half_gap[c] = fmin(half_gap[c], 0.5 * distance);
+            half_gap[o] = fmin(half_gap[o], 0.5 * distance);
+        }
+    }
+}
+
+// Metoda Lloyda: w kazdej iteracji wszystkie V x k odleglosci
+static int lloyd_kmeans(const double *points, int n, int dim, int k, int *labels,
+                        double *centroids, KmeansWorkspace *ws) {
+    int iter = 0;
+    while (iter < KMEANS_MAX_ITERATIONS) {
+        iter++;
+        int changed = 0;
+
+#pragma omp parallel for schedule(static) reduction(+ : changed) if (n >= KMEANS_MIN_PARALLEL_POINTS)
+        for (int i = 0; i < n; i++) {
+            int best_cluster = nearest_centroid(points + (size_t)i * dim, centroids, k, dim);
             if (labels[i] != best_cluster) {
                 labels[i] = best_cluster;
-                converged = 0;
+                changed++;
             }
         }
 
-        int *cluster_sizes = calloc(num_parts, sizeof(int));
-        for (int c = 0; c < num_parts; c++) {
-            for (int j = 0; j < num_eigenvectors; j++) {
-                centroids[c][j] = 0.0;
-            }
+        update_centroids(points, n, dim, k, labels, centroids, ws);
+
+        if (changed == 0) {
+            break;
         }
+    }
+    return iter;
+}
 
-        for (int i = 0; i < num_vertices; i++) {
-            int cluster = labels[i];
-            cluster_sizes[cluster]++;
-            for (int j = 0; j < num_eigenvectors; j++) {
-                centroids[cluster][j] += spectral_points[i][j];
+// Metoda Hamerly'ego: dla kazdego punktu gorna granica odleglosci do wlasnego
+// centroidu i jedna dolna do wszystkich pozostalych. Punkt, dla ktorego gorna
+// granica jest mniejsza od dolnej albo od polowy odleglosci jego centroidu do
+// najblizszego innego, nie moze zmienic etykiety i jest pomijany. Etykiety
+// sa takie same jak w metodzie Lloyda.
+static int hamerly_kmeans(const double *points, int n, int dim, int k, int *labels,
+                          double *centroids, KmeansWorkspace *ws) {
+    double *upper = malloc(n * sizeof(double));
+    double *lower = malloc(n * sizeof(double));
+    double *old = malloc((size_t)k * dim * sizeof(double));
+    double *drift = malloc(k * sizeof(double));
+    double *between = malloc((size_t)k * k * sizeof(double));
+    double *half_gap = malloc(k * sizeof(double));
+    if (!upper || !lower || !old || !drift || !between || !half_gap) {
+        free(upper);
+        free(lower);
+        free(old);
+        free(drift);
+        free(between);
+        free(half_gap);
+        return lloyd_kmeans(points, n, dim, k, labels, centroids, ws);
+    }
+
+    int iter = 0;
+    while (iter < KMEANS_MAX_ITERATIONS) {
+        iter++;
+        int changed = 0;
+        if (iter > 1) {
+            centroid_separation(centroids, k, dim, between, half_gap);
+        }
+
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+ : changed) if (n >= KMEANS_MIN_PARALLEL_POINTS)
+        for (int i = 0; i < n; i++) {
+            const double *point = points + (size_t)i * dim;
+            int a = labels[i];
+            if (iter > 1) {
+                double bound = fmax(half_gap[a], lower[i]);
+                if (bound_excludes(upper[i], bound)) {
+                    continue;
+                }
+                upper[i] = sqrt(squared_distance(point, centroids + (size_t)a * dim, dim));
+                if (bound_excludes(upper[i], bound)) {
+                    continue;
+                }
+            }
+
+            double best = DBL_MAX;
+            double second = DBL_MAX;
+            int best_cluster = -1;
+            for (int c = 0; c < k; c++) {
+                double distance = squared_distance(point, centroids + (size_t)c * dim, dim);
+                if (distance < best) {
+                    second = best;
+                    best = distance;
+                    best_cluster = c;
+                } else if (distance < second) {
+                    second = distance;
+                }
+            }
+            upper[i] = sqrt(best);
+            lower[i] = second < DBL_MAX ? sqrt(second) : DBL_MAX;
+            if (a != best_cluster) {
+                labels[i] = best_cluster;
+                changed++;
             }
         }
 
-        for (int c = 0; c < num_parts; c++) {
-            if (cluster_sizes[c] > 0) {
-                for (int j = 0; j < num_eigenvectors; j++) {
-                    centroids[c][j] /= cluster_sizes[c];
+        memcpy(old, centroids, (size_t)k * dim * sizeof(double));
+        update_centroids(points, n, dim, k, labels, centroids, ws);
+
+        if (changed == 0) {
+            break;
+        }
+
+        int max_cluster;
+        double max_drift, second_drift;
+        centroid_drift(old, centroids, k, dim, drift, &max_cluster, &max_drift, &second_drift);
+#pragma omp parallel for schedule(static) if (n >= KMEANS_MIN_PARALLEL_POINTS)
+        for (int i = 0; i < n; i++) {
+            upper[i] += drift[labels[i]];
+            lower[i] -= labels[i] == max_cluster ? second_drift : max_drift;
+        }
+    }
+
+    free(upper);
+    free(lower);
+    free(old);
+    free(drift);
+    free(between);
+    free(half_gap);
+    return iter;
+}
+
+// Metoda Elkana: osobna dolna granica dla kazdej pary punkt-centroid (V x k)
+// i odleglosci miedzy centroidami pozwalaja pominac prawie wszystkie
+// odleglosci takze przy duzym k, kosztem pamieci. Etykiety sa takie same
+// jak w metodzie Lloyda.
+static int elkan_kmeans(const double *points, int n, int dim, int k, int *labels,
+                        double *centroids, KmeansWorkspace *ws) {
+    double *upper = malloc(n * sizeof(double));
+    double *lower = malloc((size_t)n * k * sizeof(double));
+    double *old = malloc((size_t)k * dim * sizeof(double));
+    double *drift = malloc(k * sizeof(double));
+    double *between = malloc((size_t)k * k * sizeof(double));
+    double *half_gap = malloc(k * sizeof(double));
+    if (!upper || !lower || !old || !drift || !between || !half_gap) {
+        free(upper);
+        free(lower);
+        free(old);
+        free(drift);
+        free(between);
+        free(half_gap);
+        return hamerly_kmeans(points, n, dim, k, labels, centroids, ws);
+    }
+
+    int iter = 0;
+    while (iter < KMEANS_MAX_ITERATIONS) {
+        iter++;
+        int changed = 0;
+        if (iter > 1) {
+            centroid_separation(centroids, k, dim, between, half_gap);
+        }
+
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+ : changed) if (n >= KMEANS_MIN_PARALLEL_POINTS)
+        for (int i = 0; i < n; i++) {
+            const double *point = points + (size_t)i * dim;
+            double *point_lower = lower + (size_t)i * k;
+            int a = labels[i];
+
+            if (iter == 1) {
+                double best = DBL_MAX;
+                for (int c = 0; c < k; c++) {
+                    double distance = squared_distance(point, centroids + (size_t)c * dim, dim);
+                    point_lower[c] = sqrt(distance);
+                    if (distance < best) {
+                        best = distance;
+                        a = c;
+                    }
                 }
+                upper[i] = sqrt(best);
+                labels[i] = a;
+                changed++;
+                continue;
+            }
+
+            if (bound_excludes(upper[i], half_gap[a])) {
+                continue;
+            }
+            int original = a;
+            int tight = 0;
+            double upper_sq = 0.0;
+            for (int c = 0; c < k; c++) {
+                if (c == a || bound_excludes(upper[i], point_lower[c]) ||
+                    bound_excludes(upper[i], 0.5 * between[(size_t)a * k + c])) {
+                    continue;
+                }
+                if (!tight) {
+                    upper_sq = squared_distance(point, centroids + (size_t)a * dim, dim);
+                    upper[i] = sqrt(upper_sq);
+                    point_lower[a] = upper[i];
+                    tight = 1;
+                    if (bound_excludes(upper[i], point_lower[c]) ||
+                        bound_excludes(upper[i], 0.5 * between[(size_t)a * k + c])) {
+                        continue;
+                    }
+                }
+                double distance = squared_distance(point, centroids + (size_t)c * dim, dim);
+                point_lower[c] = sqrt(distance);
+                if (distance < upper_sq || (distance == upper_sq && c < a)) {
+                    a = c;
+                    upper_sq = distance;
+                    upper[i] = point_lower[c];
+                }
+            }
+            if (a != original) {
+                labels[i] = a;
+                changed++;
             }
         }
 
-        free(cluster_sizes);
+        memcpy(old, centroids, (size_t)k * dim * sizeof(double));
+        update_centroids(points, n, dim, k, labels, centroids, ws);
 
-        if (converged) {
+        if (changed == 0) {
             break;
         }
+
+        int max_cluster;
+        double max_drift, second_drift;
+        centroid_drift(old, centroids, k, dim, drift, &max_cluster, &max_drift, &second_drift);
+#pragma omp parallel for schedule(static) if (n >= KMEANS_MIN_PARALLEL_POINTS)
+        for (int i = 0; i < n; i++) {
+            double *point_lower = lower + (size_t)i * k;
+            upper[i] += drift[labels[i]];
+            for (int c = 0; c < k; c++) {
+                point_lower[c] = fmax(point_lower[c] - drift[c], 0.0);
+            }
+        }
+    }
+
+    free(upper);
+    free(lower);
+    free(old);
+    free(drift);
+    free(between);
+    free(half_gap);
+    return iter;
+}
+
+// Mini-batch k-means (Sculley): w kazdym kroku losowa probka batch_size
+// punktow jest przydzielana do najblizszych centroidow, a kazdy centroid
+// przesuwa sie w strone swoich punktow z krokiem 1 / (liczba punktow, ktore
+// dotad do niego trafily). Po batch_iterations krokach jeden pelny przydzial
+// wyznacza etykiety. Zwraca liczbe przejsc (kroki plus przydzial).
+static int minibatch_kmeans(const double *points, int n, int dim, int k, int *labels,
+                            double *centroids, KmeansWorkspace *ws, int batch_size,
+                            int batch_iterations, RngState *rng) {
+    int *batch = malloc(batch_size * sizeof(int));
+    int *batch_labels = malloc(batch_size * sizeof(int));
+    long *counts = calloc(k, sizeof(long));
+    if (!batch || !batch_labels || !counts) {
+        free(batch);
+        free(batch_labels);
+        free(counts);
+        return hamerly_kmeans(points, n, dim, k, labels, centroids, ws);
+    }
+
+    for (int step = 0; step < batch_iterations; step++) {
+        for (int b = 0; b < batch_size; b++) {
+            batch[b] = rng_int(rng, n);
+        }
+#pragma omp parallel for schedule(static) if (batch_size >= KMEANS_MIN_PARALLEL_POINTS)
+        for (int b = 0; b < batch_size; b++) {
+            batch_labels[b] =
+                nearest_centroid(points + (size_t)batch[b] * dim, centroids, k, dim);
+        }
+        for (int b = 0; b < batch_size; b++) {
+            int c = batch_labels[b];
+            const double *point = points + (size_t)batch[b] * dim;
+            double *centroid = centroids + (size_t)c * dim;
+            double eta = 1.0 / ++counts[c];
+            for (int j = 0; j < dim; j++) {
+                centroid[j] += eta * (point[j] - centroid[j]);
+            }
+        }
+    }
+
+#pragma omp parallel for schedule(static) if (n >= KMEANS_MIN_PARALLEL_POINTS)
+    for (int i = 0; i < n; i++) {
+        labels[i] = nearest_centroid(points + (size_t)i * dim, centroids, k, dim);
     }
 
-    for (int i = 0; i < num_parts; i++) {
-        free(centroids[i]);
+    free(batch);
+    free(batch_labels);
+    free(counts);
+    return batch_iterations + 1;
+}
+
+int *kmeans_clustering(const double *spectral_points, int num_vertices, int num_eigenvectors,
+                       int num_parts, const Config *config, RngState *rng, int *iterations) {
+    int dim = num_eigenvectors;
+    int *labels = malloc(num_vertices * sizeof(int));
+    double *centroids = calloc((size_t)num_parts * dim, sizeof(double));
+    double *d2 = malloc(num_vertices * sizeof(double));
+    KmeansWorkspace ws;
+    ws.partial_sums = malloc((size_t)KMEANS_CHUNKS * num_parts * dim * sizeof(double));
+    ws.partial_counts = malloc((size_t)KMEANS_CHUNKS * num_parts * sizeof(int));
+    ws.cluster_sizes = malloc(num_parts * sizeof(int));
+
+    if (!labels || !centroids || !d2 || !ws.partial_sums || !ws.partial_counts ||
+        !ws.cluster_sizes) {
+        error("Nie udało się alokować pamięci dla centroidów.\n");
+        free(labels);
+        free(centroids);
+        free(d2);
+        free(ws.partial_sums);
+        free(ws.partial_counts);
+        free(ws.cluster_sizes);
+        return NULL;
+    }
+
+    for (int i = 0; i < num_vertices; i++) {
+        labels[i] = -1;
+    }
+
+    int seeded = 0;
+    KmeansInit init = config->kmeans_init;
+    if (init == KMEANS_INIT_PLUSPLUS) {
+        seeded = seed_kmeanspp(spectral_points, NULL, num_vertices, dim, num_parts, rng,
+                               centroids, d2);
+    } else if (init == KMEANS_INIT_PARALLEL) {
+        seeded = seed_kmeans_parallel(spectral_points, num_vertices, dim, num_parts, rng,
+                                      centroids, d2);
+    } else if (init == KMEANS_INIT_FARTHEST) {
+        seeded = seed_farthest(spectral_points, num_vertices, dim, num_parts, rng, centroids, d2);
+    }
+    // losowe wierzcholki (takze gdy roznych punktow jest mniej niz partycji)
+    for (int i = seeded; i < num_parts; i++) {
+        int random_index = rng_int(rng, num_vertices);
+        memcpy(centroids + (size_t)i * dim, spectral_points + (size_t)random_index * dim,
+               dim * sizeof(double));
+    }
+    free(d2);
+
+    int iter;
+    if (config->kmeans_algorithm == KMEANS_MINIBATCH) {
+        iter = minibatch_kmeans(spectral_points, num_vertices, dim, num_parts, labels, centroids,
+                                &ws, config->batch_size, config->batch_iterations, rng);
+    } else if (config->kmeans_algorithm == KMEANS_ELKAN) {
+        iter = elkan_kmeans(spectral_points, num_vertices, dim, num_parts, labels, centroids,
+                            &ws);
+    } else if (config->kmeans_algorithm == KMEANS_HAMERLY) {
+        iter = hamerly_kmeans(spectral_points, num_vertices, dim, num_parts, labels, centroids,
+                              &ws);
+    } else {
+        iter = lloyd_kmeans(spectral_points, num_vertices, dim, num_parts, labels, centroids,
+                            &ws);
+    }
+    if (iterations) {
+        *iterations = iter;
     }
 
+    free(ws.partial_sums);
+    free(ws.partial_counts);
+    free(ws.cluster_sizes);
     free(centroids);
 
     return labels;
@@ -1,7 +1,12 @@
 #ifndef KMEANS_H
 #define KMEANS_H
+#include "args_parser.h"
+#include "rng.h"
 
-int *kmeans_clustering(double **spectral_points, int num_vertices, int num_eigenvectors,
-                       int num_parts);
+// spectral_points - tablica num_vertices x num_eigenvectors, wierszami;
+// metoda i poczatkowe centroidy wedlug config; w *iterations (jesli nie NULL)
+// liczba iteracji do zbieznosci
+int *kmeans_clustering(const double *spectral_points, int num_vertices, int num_eigenvectors,
+                       int num_parts, const Config *config, RngState *rng, int *iterations);
 
 #endif
@@ -0,0 +1,333 @@
+#include "lanczos.h"
+#include "log_utils.h"
+#include "printfcolor.h"
+#include "vector_kernels.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LANCZOS_TOLERANCE 1e-7         // luzniejsza wyraznie pogarsza ciecie po k-srednich
+#define LANCZOS_MAX_ITERATIONS 20000    // limit mnozen przez macierz Laplace'a
+#define LANCZOS_MIN_EXTRA_VECTORS 60    // wektory bazy ponad liczbe szukanych
+#define LANCZOS_KEEP_DIVISOR 4          // restart zachowuje nev + (m - nev) / 4 wektorow Ritza
+#define LANCZOS_ROW_BLOCK 64            // wiersze przeliczane naraz przy restarcie
+#define LANCZOS_REORTH_THRESHOLD 0.7071 // drugi przebieg ortogonalizacji ponizej tej proporcji
+
+// usuwa skladowa stala (wektor wlasny dla wartosci 0) i skladowe wzdluz
+// v_0..v_{count-1}; wspolczynniki rzutow trafiaja do h. Rzuty przebiegu sa
+// liczone naraz (klasyczny Gram-Schmidt), a drugi przebieg jest wykonywany
+// tylko wtedy, gdy pierwszy mocno skrocil wektor (kryterium DGKS), bo wtedy
+// zostaja w nim bledy zaokraglen.
+static void orthogonalize(double *w, double *basis, int count, int n, double *h, double *coef) {
+    for (int i = 0; i < count; i++) {
+        h[i] = 0.0;
+    }
+    double norm_before = vec_nrm2(w, n);
+    for (int pass = 0; pass < 2; pass++) {
+        vec_shift(-vec_sum(w, n) / n, w, n);
+        vec_multi_dot(basis, n, count, w, n, coef);
+        vec_multi_axpy(basis, n, count, coef, w, n);
+        for (int i = 0; i < count; i++) {
+            h[i] += coef[i];
+        }
+
+        double norm_after = vec_nrm2(w, n);
+        if (norm_after > LANCZOS_REORTH_THRESHOLD * norm_before) {
+            break;
+        }
+        norm_before = norm_after;
+    }
+}
+
+// Szacuje omega[j + 1][l] = v_{j+1}^T v_l dla l < j (Simon) bez liczenia
+// iloczynow skalarnych. Kolumna l macierzy T zawiera wspolczynniki L v_l w
+// bazie (po grubym restarcie takze poza trzema przekatnymi), wiec z
+// v_l^T L v_j = v_j^T L v_l wynika
+//   beta_j omega[j+1][l] = sum_i T[i][l] omega[i][j] - sum_i T[i][j] omega[i][l],
+// a bledy zaokraglen kazdego kroku sa doliczane jako eps1 * ||L|| / beta_j.
+// Zwraca najwiekszy modul oszacowania.
+static double update_omega(double *omega, int ld, const double *t, int m, int j, double beta,
+                           double eps1, double anorm) {
+    double *next = omega + (size_t)(j + 1) * ld;
+    double largest = 0.0;
+    for (int l = 0; l < j; l++) {
+        double sum = 0.0;
+        for (int i = 0; i <= j; i++) {
+            sum += t[i * m + l] * omega[(size_t)i * ld + j] -
+                   t[i * m + j] * omega[(size_t)i * ld + l];
+        }
+        next[l] = (sum + copysign(eps1 * anorm, sum)) / beta;
+        omega[(size_t)l * ld + j + 1] = next[l];
+        largest = fmax(largest, fabs(next[l]));
+    }
+    next[j] = eps1;
+    omega[(size_t)j * ld + j + 1] = eps1;
+    next[j + 1] = 1.0;
+    return largest;
+}
+
+// v_{j+1} jest ortogonalny do v_0..v_j z dokladnoscia zaokraglen
+static void reset_omega(double *omega, int ld, int j, double eps1) {
+    for (int l = 0; l <= j; l++) {
+        omega[(size_t)(j + 1) * ld + l] = eps1;
+        omega[(size_t)l * ld + j + 1] = eps1;
+    }
+    omega[(size_t)(j + 1) * ld + j + 1] = 1.0;
+}
+
+// nadpisuje pierwsze k wektorow bazy kombinacjami basis * y[:, 0..k); bloki
+// wierszy bazy sa przepisywane do kafelka zapisanego wierszami, a kombinacje
+// liczy vec_rows_gemm ze wspolczynnikami coef (m x k, bez reszty kolumn y)
+static void combine_basis(double *basis, int n, int m, const double *y, int k, double *coef,
+                          double *tile) {
+    for (int j = 0; j < m; j++) {
+        memcpy(coef + (size_t)j * k, y + (size_t)j * m, k * sizeof(double));
+    }
+    double *out = tile + (size_t)LANCZOS_ROW_BLOCK * m;
+    for (int r0 = 0; r0 < n; r0 += LANCZOS_ROW_BLOCK) {
+        int rows = (n - r0 < LANCZOS_ROW_BLOCK) ? n - r0 : LANCZOS_ROW_BLOCK;
+        for (int j = 0; j < m; j++) {
+            const double *vj = basis + (size_t)j * n + r0;
+            for (int r = 0; r < rows; r++) {
+                tile[(size_t)r * m + j] = vj[r];
+            }
+        }
+        vec_rows_gemm(tile, m, m, coef, k, out, k, rows, 0);
+        for (int c = 0; c < k; c++) {
+            double *vc = basis + (size_t)c * n + r0;
+            for (int r = 0; r < rows; r++) {
+                vc[r] = out[(size_t)r * k + c];
+            }
+        }
+    }
+}
+
+// Lanczos z grubym restartem (thick restart) dla najmniejszych nietrywialnych
+// wartosci wlasnych macierzy Laplace'a. Kolejne wektory sa ortogonalizowane
+// tylko wzgledem dwoch poprzednich, a utrata ortogonalnosci wzgledem reszty
+// bazy jest sledzona rekurencja omega (czesciowa reortogonalizacja, Simon):
+// pelny Gram-Schmidt wzgledem calej bazy jest wykonywany dopiero, gdy
+// oszacowanie przekroczy sqrt(eps), i jeszcze w nastepnym kroku. Pierwszy
+// krok po restarcie zawsze ortogonalizuje wzgledem calej bazy, bo L v_k ma
+// skladowe wzdluz wszystkich zachowanych wektorow Ritza. Po zapelnieniu m
+// wektorow zostaje k najlepszych wektorow Ritza i wektor residuum, od ktorego
+// iteracja jest kontynuowana.
+DenseVector **compute_eigenvectors_lanczos(SparseMatrix *adj_matrix, int num_eigenvectors,
+                                           EigensolverStats *stats) {
+    int n = adj_matrix ? adj_matrix->rows : 0;
+    int nev = num_eigenvectors;
+    if (!adj_matrix || nev <= 0 || nev > n - 1) {
+        error("Niepoprawne dane wejściowe.\n");
+        return NULL;
+    }
+
+    int m = 2 * nev > nev + LANCZOS_MIN_EXTRA_VECTORS ? 2 * nev : nev + LANCZOS_MIN_EXTRA_VECTORS;
+    if (m > n - 1) {
+        m = n - 1;
+    }
+
+    double *basis = malloc((size_t)n * (m + 1) * sizeof(double));
+    double *t = calloc((size_t)m * m, sizeof(double));
+    double *y = malloc((size_t)m * m * sizeof(double));
+    double *omega = malloc((size_t)(m + 1) * (m + 1) * sizeof(double));
+    double *theta = malloc(m * sizeof(double));
+    double *h = malloc((m + 1) * sizeof(double));
+    double *coef = malloc((size_t)m * m * sizeof(double));
+    double *tile = malloc((size_t)LANCZOS_ROW_BLOCK * 2 * m * sizeof(double));
+    DenseVector **eigenvectors = calloc(nev, sizeof(DenseVector *));
+    if (!basis || !t || !y || !omega || !theta || !h || !coef || !tile || !eigenvectors) {
+        error("Nie udało się zaalokować pamięci dla bazy Lanczosa.\n");
+        free(basis);
+        free(t);
+        free(y);
+        free(omega);
+        free(theta);
+        free(h);
+        free(coef);
+        free(tile);
+        free(eigenvectors);
+        return NULL;
+    }
+
+    // ||L|| <= 2 * max stopien (Gerszgorin) wystarcza do skali bledow w omega
+    int max_degree = 0;
+    for (int i = 0; i < n; i++) {
+        int degree = adj_matrix->row_ptr[i + 1] - adj_matrix->row_ptr[i];
+        max_degree = degree > max_degree ? degree : max_degree;
+    }
+    double anorm_bound = 2.0 * max_degree;
+    double eps1 = DBL_EPSILON * sqrt((double)n);
+    double semi_orthogonality = sqrt(DBL_EPSILON);
+
+    DenseVector start = {n, basis};
+    for (int r = 0; r < n; r++) {
+        basis[r] = 2.0 * rand() / RAND_MAX - 1.0;
+    }
+    orthogonalize(basis, basis, 0, n, h, coef);
+    normalize_vector(&start);
+    omega[0] = 1.0;
+
+    int k = 0;
+    int iterations = 0;
+    int restarts = 0;
+    int converged = 0;
+    double max_residual = 0.0;
+
+    for (;;) {
+        double beta = 0.0;
+        int reorth_next = 0;
+        for (int j = k; j < m; j++) {
+            double *vj = basis + (size_t)j * n;
+            double *w = basis + (size_t)(j + 1) * n;
+            DenseVector vj_vector = {n, vj};
+            DenseVector w_vector = {n, w};
+            apply_laplacian(adj_matrix, &vj_vector, &w_vector);
+            iterations++;
+
+            if (j == k) {
+                orthogonalize(w, basis, j + 1, n, h, coef);
+                for (int i = 0; i <= j; i++) {
+                    t[i * m + j] = h[i];
+                    t[j * m + i] = h[i];
+                }
+            } else {
+                // wektor staly jest w jadrze L, wiec jego skladowa pochodzi
+                // tylko z zaokraglen i jest usuwana w kazdym kroku
+                vec_shift(-vec_sum(w, n) / n, w, n);
+                vec_axpy(-t[(j - 1) * m + j], basis + (size_t)(j - 1) * n, w, n);
+                double alpha = vec_dot(vj, w, n);
+                vec_axpy(-alpha, vj, w, n);
+                t[j * m + j] = alpha;
+            }
+
+            beta = vec_nrm2(w, n);
+            if (beta > 1e-12 * (fabs(t[j * m + j]) + 1.0)) {
+                int reorth = reorth_next;
+                if (j == k) {
+                    reset_omega(omega, m + 1, j, eps1);
+                } else if (update_omega(omega, m + 1, t, m, j, beta, eps1, anorm_bound) >
+                           semi_orthogonality) {
+                    reorth = 1;
+                }
+                // po reortogonalizacji kolejny wektor tez jest ortogonalizowany
+                // wzgledem calej bazy, bo dziedziczy bledy z poprzedniego
+                reorth_next = reorth && !reorth_next;
+                if (reorth) {
+                    orthogonalize(w, basis, j + 1, n, h, coef);
+                    reset_omega(omega, m + 1, j, eps1);
+                    beta = vec_nrm2(w, n);
+                }
+                if (j + 1 < m) {
+                    t[j * m + j + 1] = beta;
+                    t[(j + 1) * m + j] = beta;
+                }
+                vec_scale(1.0 / beta, w, n);
+                continue;
+            }
+
+            // podprzestrzen niezmiennicza - dalej od nowego, losowego kierunku
+            beta = 0.0;
+            reorth_next = 0;
+            if (j + 1 < m) {
+                for (int r = 0; r < n; r++) {
+                    w[r] = 2.0 * rand() / RAND_MAX - 1.0;
+                }
+                orthogonalize(w, basis, j + 1, n, h, coef);
+                normalize_vector(&w_vector);
+                reset_omega(omega, m + 1, j, eps1);
+                t[j * m + j + 1] = 0.0;
+                t[(j + 1) * m + j] = 0.0;
+            }
+        }
+
+        if (!symmetric_eigen_decomposition(t, m, theta, y)) {
+            free_eigenvectors(eigenvectors, nev);
+            eigenvectors = NULL;
+            break;
+        }
+
+        double anorm = fmax(fabs(theta[0]), fabs(theta[m - 1]));
+        converged = 0;
+        max_residual = 0.0;
+        for (int i = 0; i < nev; i++) {
+            double residual = fabs(beta * y[(m - 1) * m + i]);
+            max_residual = fmax(max_residual, residual);
+            if (residual <= LANCZOS_TOLERANCE * anorm) {
+                converged++;
+            }
+        }
+
+        if (converged == nev || iterations >= LANCZOS_MAX_ITERATIONS || m <= nev) {
+            break;
+        }
+
+        // gruby restart: k wektorow Ritza + wektor residuum jako v_k; wektory
+        // Ritza sa kombinacjami prawie ortogonalnej bazy, a v_k jest do nich
+        // dodatkowo jawnie ortogonalizowany. Maly zapas ponad nev skraca
+        // skladanie bazy, ktore kosztuje m * k na wiersz przy kazdym restarcie.
+        k = nev + (m - nev) / LANCZOS_KEEP_DIVISOR;
+        if (k > m - 1) {
+            k = m - 1;
+        }
+        combine_basis(basis, n, m, y, k, coef, tile);
+        double *vk = basis + (size_t)k * n;
+        memcpy(vk, basis + (size_t)m * n, n * sizeof(double));
+        orthogonalize(vk, basis, k, n, h, coef);
+        DenseVector vk_vector = {n, vk};
+        normalize_vector(&vk_vector);
+        memset(t, 0, (size_t)m * m * sizeof(double));
+        for (int i = 0; i < k; i++) {
+            t[i * m + i] = theta[i];
+            for (int l = 0; l < i; l++) {
+                omega[(size_t)i * (m + 1) + l] = eps1;
+                omega[(size_t)l * (m + 1) + i] = eps1;
+            }
+            omega[(size_t)i * (m + 1) + i] = 1.0;
+        }
+        reset_omega(omega, m + 1, k - 1, eps1);
+        restarts++;
+        printfc_fg(GREY, ". ");
+        fflush(stdout);
+    }
+
+    if (eigenvectors) {
+        combine_basis(basis, n, m, y, nev, coef, tile);
+        for (int i = 0; i < nev; i++) {
+            eigenvectors[i] = malloc(sizeof(DenseVector));
+            if (!eigenvectors[i]) {
+                error("Nie udało się zaalokować pamięci dla wektora własnego: %d.\n", i);
+                free_eigenvectors(eigenvectors, nev);
+                eigenvectors = NULL;
+                break;
+            }
+            eigenvectors[i]->size = n;
+            eigenvectors[i]->values = malloc(n * sizeof(double));
+            if (!eigenvectors[i]->values) {
+                error("Nie udało się zaalokować pamięci dla wartości wektora własnego: %d.\n", i);
+                free_eigenvectors(eigenvectors, nev);
+                eigenvectors = NULL;
+                break;
+            }
+            memcpy(eigenvectors[i]->values, basis + (size_t)i * n, n * sizeof(double));
+        }
+    }
+
+    if (stats) {
+        stats->iterations = iterations;
+        stats->restarts = restarts;
+        stats->converged = converged;
+        stats->max_residual = max_residual;
+    }
+
+    free(basis);
+    free(t);
+    free(y);
+    free(omega);
+    free(theta);
+    free(h);
+    free(coef);
+    free(tile);
+    return eigenvectors;
+}
@@ -0,0 +1,8 @@
+#ifndef LANCZOS_H
+#define LANCZOS_H
+#include "spectral_algorithm.h"
+
+DenseVector **compute_eigenvectors_lanczos(SparseMatrix *adj_matrix, int num_eigenvectors,
+                                           EigensolverStats *stats);
+
+#endif
@@ -0,0 +1,306 @@
+#include "lobpcg.h"
+#include "log_utils.h"
+#include "printfcolor.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOBPCG_TOLERANCE 1e-7
+#define LOBPCG_MAX_ITERATIONS 1000    // limit iteracji blokowych
+#define LOBPCG_GUARD_VECTORS 2        // dodatkowe wektory przyspieszajace zbieznosc ostatnich
+#define LOBPCG_PROGRESS_INTERVAL 10
+#define LOBPCG_DROP_TOLERANCE 1e-10   // kierunki P skrocone ponizej tej proporcji sa pomijane
+
+// h = S^T L S dla S = [X, P, W] o b, np i nw kolumnach. Liczone sa tylko
+// bloki nad przekatna: S^T L [P, W] dla wierszy X i P oraz W^T L W; blok
+// X^T L X to diag(theta), gdy X sa wektorami Ritza z poprzedniego kroku.
+static void projected_matrix(const double *s, const double *as, int b, int np, int nw,
+                             const double *theta, int ld, int n, BlockWorkspace *ws, double *h) {
+    int ncols = b + np + nw;
+    int m = np + nw;
+    double *g = ws->gram;
+    if (theta) {
+        for (int i = 0; i < b; i++) {
+            for (int j = 0; j < b; j++) {
+                h[i * ncols + j] = i == j ? theta[i] : 0.0;
+            }
+        }
+    } else {
+        block_inner_products(s, b, as, b, ld, n, ws, g);
+        for (int i = 0; i < b; i++) {
+            memcpy(h + i * ncols, g + i * b, b * sizeof(double));
+        }
+    }
+    if (m > 0) {
+        block_inner_products(s, b + np, as + b, m, ld, n, ws, g);
+        for (int i = 0; i < b + np; i++) {
+            memcpy(h + i * ncols + b, g + i * m, m * sizeof(double));
+        }
+    }
+    if (nw > 0) {
+        block_inner_products(s + b + np, nw, as + b + np, nw, ld, n, ws, g);
+        for (int i = 0; i < nw; i++) {
+            memcpy(h + (b + np + i) * ncols + b + np, g + i * nw, nw * sizeof(double));
+        }
+    }
+
+    // wewnatrz blokow obie polowki sa policzone i sa usredniane, a pod
+    // blokami przekatnej przepisywane z gory
+    for (int i = 0; i < ncols; i++) {
+        int block_i = i < b ? 0 : i < b + np ? 1 : 2;
+        for (int j = i + 1; j < ncols; j++) {
+            int block_j = j < b ? 0 : j < b + np ? 1 : 2;
+            double value = h[i * ncols + j];
+            if (block_i == block_j) {
+                value = 0.5 * (value + h[j * ncols + i]);
+                h[i * ncols + j] = value;
+            }
+            h[j * ncols + i] = value;
+        }
+    }
+}
+
+// Wspolczynniki nowego P (kolumny b..2b-1 macierzy coef o ncols wierszach po
+// 2b elementow) sa ortonormalizowane wzgledem wspolczynnikow X i siebie
+// nawzajem. S jest ortonormalna, wiec iloczyny skalarne wektorow S * c sa
+// rowne iloczynom ich wspolczynnikow i cala ortonormalizacja P odbywa sie na
+// malej macierzy zamiast na wektorach dlugosci n. Kierunki zalezne sa
+// pomijane, a macierz jest zageszczana do b + np kolumn w wierszu; zwraca np.
+static int orthonormalize_directions(double *coef, int ncols, int b) {
+    int stride = 2 * b;
+    int kept = 0;
+    for (int c = b; c < stride; c++) {
+        double norm0 = 0.0;
+        for (int j = 0; j < ncols; j++) {
+            norm0 += coef[j * stride + c] * coef[j * stride + c];
+        }
+        for (int pass = 0; pass < 2; pass++) {
+            for (int k = 0; k < b + kept; k++) {
+                double dot = 0.0;
+                for (int j = 0; j < ncols; j++) {
+                    dot += coef[j * stride + k] * coef[j * stride + c];
+                }
+                for (int j = 0; j < ncols; j++) {
+                    coef[j * stride + c] -= dot * coef[j * stride + k];
+                }
+            }
+        }
+        double norm = 0.0;
+        for (int j = 0; j < ncols; j++) {
+            norm += coef[j * stride + c] * coef[j * stride + c];
+        }
+        norm = sqrt(norm);
+        if (norm0 == 0.0 || norm <= LOBPCG_DROP_TOLERANCE * sqrt(norm0)) {
+            continue;
+        }
+        int dst = b + kept;
+        for (int j = 0; j < ncols; j++) {
+            coef[j * stride + dst] = coef[j * stride + c] / norm;
+        }
+        kept++;
+    }
+    int width = b + kept;
+    for (int j = 1; j < ncols; j++) {
+        memmove(coef + j * width, coef + j * stride, width * sizeof(double));
+    }
+    return kept;
+}
+
+// LOBPCG (Knyazev) dla najmniejszych nietrywialnych wartosci wlasnych
+// macierzy Laplace'a. Caly blok X jest iterowany naraz: w kazdym kroku baza
+// S = [X, P, W] (biezace przyblizenia, poprzednie kierunki i
+// prekondycjonowane residua) jest jawnie ortonormalizowana, a metoda
+// Rayleigha-Ritza na malej macierzy S^T L S wyznacza nowe X i P. Nowe P jest
+// ortonormalizowane na wspolczynnikach, wiec jedynymi operacjami na calych
+// wektorach poza mnozeniem przez L sa: budowa S^T L S, zlozenie X i P oraz
+// ortonormalizacja W. Wektory, ktore juz osiagnely zbieznosc, nie dokladaja
+// kierunkow do W.
+DenseVector **compute_eigenvectors_lobpcg(SparseMatrix *adj_matrix, int num_eigenvectors,
+                                          Preconditioner *precond, EigensolverStats *stats) {
+    int n = adj_matrix ? adj_matrix->rows : 0;
+    int nev = num_eigenvectors;
+    if (!adj_matrix || nev <= 0 || nev > n - 1) {
+        error("Niepoprawne dane wejściowe.\n");
+        return NULL;
+    }
+
+    int b = nev + LOBPCG_GUARD_VECTORS;
+    if (b > n - 1) {
+        b = n - 1;
+    }
+    int max_cols = 3 * b;
+
+    // S i L * S sa zapisane wierszami (kolumna c wiersza r to s[r * max_cols + c]),
+    // zeby mnozenie przez L i wszystkie operacje gestej algebry czytaly caly
+    // wiersz bazy naraz; residua sa skladane kolumnami dla prekondycjonera
+    double *s = malloc((size_t)n * max_cols * sizeof(double));
+    double *as = malloc((size_t)n * max_cols * sizeof(double));
+    double *h = malloc((size_t)max_cols * max_cols * sizeof(double));
+    double *y = malloc((size_t)max_cols * max_cols * sizeof(double));
+    double *coef = malloc((size_t)max_cols * 2 * b * sizeof(double));
+    double *theta = malloc(max_cols * sizeof(double));
+    double *residuals = malloc(b * sizeof(double));
+    double *r = malloc((size_t)n * b * sizeof(double));
+    double *z = malloc(n * sizeof(double));
+    int *active = malloc(b * sizeof(int));
+    DenseVector **eigenvectors = calloc(nev, sizeof(DenseVector *));
+    BlockWorkspace ws = {0};
+    if (!s || !as || !h || !y || !coef || !theta || !residuals || !r || !z || !active ||
+        !eigenvectors || !init_block_workspace(&ws, max_cols, b, n)) {
+        error("Nie udało się zaalokować pamięci dla bazy LOBPCG.\n");
+        free(s);
+        free(as);
+        free(h);
+        free(y);
+        free(coef);
+        free(theta);
+        free(residuals);
+        free(r);
+        free(z);
+        free(active);
+        free(eigenvectors);
+        free_block_workspace(&ws);
+        return NULL;
+    }
+
+    for (int kept = 0; kept < b;) {
+        for (int i = 0; i < n; i++) {
+            for (int col = kept; col < b; col++) {
+                s[(size_t)i * max_cols + col] = 2.0 * rand() / RAND_MAX - 1.0;
+            }
+        }
+        kept += orthonormalize_block(s + kept, NULL, b - kept, s, NULL, kept, max_cols, n, &ws);
+    }
+    multiply_sparse_matrix_block(adj_matrix, s, as, b, max_cols);
+
+    int iterations = b;
+    int outer = 0;
+    int converged = 0;
+    int np = 0;
+    int nw = 0;
+    double anorm = 0.0;
+    double max_residual = 0.0;
+
+    for (;;) {
+        int ncols = b + np + nw;
+        projected_matrix(s, as, b, np, nw, outer > 0 ? theta : NULL, max_cols, n, &ws, h);
+        if (!symmetric_eigen_decomposition(h, ncols, theta, y)) {
+            free_eigenvectors(eigenvectors, nev);
+            eigenvectors = NULL;
+            break;
+        }
+
+        // nowe X = S * y[:, 0..b), a nowe P to czesc tych wektorow spoza
+        // starego X (wiersze y od b wzwyz), ortogonalna do nowego X; oba sa
+        // skladane jednym przebiegiem
+        for (int j = 0; j < ncols; j++) {
+            for (int c = 0; c < b; c++) {
+                coef[j * 2 * b + c] = y[j * ncols + c];
+                coef[j * 2 * b + b + c] = j >= b ? y[j * ncols + c] : 0.0;
+            }
+        }
+        np = orthonormalize_directions(coef, ncols, b);
+        block_combine(s, ncols, coef, b + np, s, max_cols, n, &ws);
+        block_combine(as, ncols, coef, b + np, as, max_cols, n, &ws);
+        outer++;
+
+        anorm = fmax(anorm, fabs(theta[ncols - 1]));
+        double tolerance = LOBPCG_TOLERANCE * anorm;
+        block_residual_norms(s, as, b, theta, max_cols, n, &ws, residuals);
+        converged = 0;
+        max_residual = 0.0;
+        for (int i = 0; i < nev; i++) {
+            max_residual = fmax(max_residual, residuals[i]);
+            converged += residuals[i] <= tolerance;
+        }
+        if (converged == nev || outer >= LOBPCG_MAX_ITERATIONS) {
+            break;
+        }
+
+        nw = 0;
+        for (int i = 0; i < b; i++) {
+            if (residuals[i] > tolerance) {
+                active[nw++] = i;
+            }
+        }
+        if (nw == 0) {
+            break;
+        }
+        for (int k = 0; k < n; k++) {
+            const double *sk = s + (size_t)k * max_cols;
+            const double *ask = as + (size_t)k * max_cols;
+            for (int c = 0; c < nw; c++) {
+                int i = active[c];
+                r[(size_t)c * n + k] = ask[i] - theta[i] * sk[i];
+            }
+        }
+        if (precond) {
+            for (int c = 0; c < nw; c++) {
+                precond->apply(precond, r + (size_t)c * n, z);
+                memcpy(r + (size_t)c * n, z, n * sizeof(double));
+            }
+        }
+        int col = b + np;
+        for (int k = 0; k < n; k++) {
+            double *sk = s + (size_t)k * max_cols + col;
+            for (int c = 0; c < nw; c++) {
+                sk[c] = r[(size_t)c * n + k];
+            }
+        }
+        nw = orthonormalize_block(s + col, NULL, nw, s, NULL, col, max_cols, n, &ws);
+        if (nw == 0) {
+            break;
+        }
+        multiply_sparse_matrix_block(adj_matrix, s + col, as + col, nw, max_cols);
+        iterations += nw;
+
+        if (outer % LOBPCG_PROGRESS_INTERVAL == 0) {
+            printfc_fg(GREY, ". ");
+            fflush(stdout);
+        }
+    }
+
+    if (eigenvectors) {
+        for (int i = 0; i < nev; i++) {
+            eigenvectors[i] = malloc(sizeof(DenseVector));
+            if (!eigenvectors[i]) {
+                error("Nie udało się zaalokować pamięci dla wektora własnego: %d.\n", i);
+                free_eigenvectors(eigenvectors, nev);
+                eigenvectors = NULL;
+                break;
+            }
+            eigenvectors[i]->size = n;
+            eigenvectors[i]->values = malloc(n * sizeof(double));
+            if (!eigenvectors[i]->values) {
+                error("Nie udało się zaalokować pamięci dla wartości wektora własnego: %d.\n", i);
+                free_eigenvectors(eigenvectors, nev);
+                eigenvectors = NULL;
+                break;
+            }
+            for (int k = 0; k < n; k++) {
+                eigenvectors[i]->values[k] = s[(size_t)k * max_cols + i];
+            }
+        }
+    }
+
+    if (stats) {
+        stats->iterations = iterations;
+        stats->restarts = outer;
+        stats->converged = converged;
+        stats->max_residual = max_residual;
+    }
+
+    free(s);
+    free(as);
+    free(h);
+    free(y);
+    free(coef);
+    free(theta);
+    free(residuals);
+    free(r);
+    free(z);
+    free(active);
+    free_block_workspace(&ws);
+    return eigenvectors;
+}
@@ -0,0 +1,9 @@
+#ifndef LOBPCG_H
+#define LOBPCG_H
+#include "preconditioner.h"
+#include "spectral_algorithm.h"
+
+DenseVector **compute_eigenvectors_lobpcg(SparseMatrix *adj_matrix, int num_eigenvectors,
+                                          Preconditioner *precond, EigensolverStats *stats);
+
+#endif
@@ -4,7 +4,9 @@
 #include "log_utils.h"
 #include "partitioner.h"
 
+#include <omp.h>
 #include <stdlib.h>
+#include <string.h>
 
 int main(int argc, char **argv) {
     Config config;
@@ -16,39 +18,66 @@ int main(int argc, char **argv) {
         print_config(&config);
     }
     srand(config.seed);
+    if (config.num_threads > 0) {
+        omp_set_num_threads(config.num_threads);
+    }
 
-    int graph_count = 0;
-    Graph **graphs = read_multiple_graphs(config.input_filename, &graph_count);
+    if (!config.input_filename) {
+        error("Brakuje pliku wejściowego. Wpisz %s --help, aby wyświetlić pomoc.\n", argv[0]);
+        free_config(&config);
+        return 1;
+    }
 
-    int num_parts = config.num_parts;
-    float max_imbalance = config.max_imbalance;
-    int num_attempts = config.num_attempts;
+    int graph_count = 0;
     int graph_index = config.graph_index;
+    Graph *graph;
+    if (strcmp(get_file_extension(config.input_filename), "gpbin") == 0) {
+        if (graph_index != 0) {
+            error("Plik gpbin zawiera jeden graf o indeksie 0.\n");
+            free_config(&config);
+            return 1;
+        }
+        graph = read_graph_from_gpbin(config.input_filename);
+        if (!graph) {
+            free_config(&config);
+            return 1;
+        }
+    } else {
+        graph = read_graph_at_index(config.input_filename, graph_index, &graph_count);
+    }
 
-    if (graph_index >= graph_count) {
-        if (graph_count == 1) {
+    if (!graph) {
+        if (graph_index >= graph_count && graph_count == 1) {
             error("Graf o indeksie %d nie istnieje. Jedyny dostępny "
                   "graf ma "
                   "indeks %d.\n",
                   graph_index, graph_count - 1);
-        } else {
+        } else if (graph_index >= graph_count && graph_count > 1) {
             error("Graf o indeksie %d nie istnieje. Zakres indeksów to "
                   "(0-%d).\n",
                   graph_index, graph_count - 1);
         }
-        free_multiple_graphs(graphs, graph_count);
+        free_config(&config);
         return 1;
     }
-    print_graph_details(graphs[graph_index]);
-    if (config.num_attempts > 10000 && graphs[graph_index]->num_vertices > 10000) {
+    print_graph_details(graph);
+
+    if (config.convert_filename) {
+        int saved = save_graph_in_gpbin_format(graph, config.convert_filename);
+        free_memory(graph);
+        free_config(&config);
+        return saved ? 0 : 1;
+    }
+
+    if (config.num_attempts > 10000 && graph->num_vertices > 10000) {
         warn(" Graf jest bardzo duży, przy podanej liczbie powtórzeń "
             "przetwarzanie może zająć dużo czasu.\n");
     }
 
-    PartitionResult *result =
-        spectral_partition(graphs[graph_index], num_parts, max_imbalance, num_attempts);
+    PartitionResult *result = spectral_partition(graph, &config);
     if (!result) {
-        free_multiple_graphs(graphs, graph_count);
+        free_memory(graph);
+        free_config(&config);
         return 1;
     }
 
@@ -60,6 +89,6 @@ int main(int argc, char **argv) {
 
     free_config(&config);
     free_partition_result(result);
-    free_multiple_graphs(graphs, graph_count);
+    free_memory(graph);
     return 0;
 }
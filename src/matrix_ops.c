@@ -1,226 +1,153 @@
 #include "matrix_ops.h"
 #include "log_utils.h"
+#include "vector_kernels.h"
 #include <math.h>
+#include <omp.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-SparseMatrix *transpose_sparse_matrix(SparseMatrix *matrix) {
-    // alokowanie pamieci dla macierzy transponowanej
-    SparseMatrix *transpose = malloc(sizeof(SparseMatrix));
-    transpose->rows = matrix->cols;
-    transpose->cols = matrix->rows;
-    transpose->nnz = matrix->nnz;
+#define SPMV_PARALLEL_MIN_NNZ 16384 // mniejsze macierze nie oplacaja sie watkom
 
-    transpose->values = malloc(matrix->nnz * sizeof(double));
-    transpose->col_indices = malloc(matrix->nnz * sizeof(int));
-    transpose->row_ptr = calloc((matrix->cols + 1), sizeof(int));
+static SpmvStats spmv_stats;
 
-    for (int i = 0; i < matrix->nnz; i++) {
-        transpose->row_ptr[matrix->col_indices[i] + 1]++;
-    }
-
-    for (int i = 0; i < matrix->cols; i++) {
-        transpose->row_ptr[i + 1] += transpose->row_ptr[i];
-    }
-
-    int *current_pos = calloc(matrix->cols, sizeof(int));
-    for (int i = 0; i < matrix->cols; i++) {
-        current_pos[i] = transpose->row_ptr[i];
-    }
-
-    for (int row = 0; row < matrix->rows; row++) {
-        for (int j = matrix->row_ptr[row]; j < matrix->row_ptr[row + 1]; j++) {
-            int col = matrix->col_indices[j];
-            int pos = current_pos[col];
-
-            transpose->values[pos] = matrix->values[j];
-            transpose->col_indices[pos] = row;
+// iloczyn skalarny
+double dot_product(DenseVector *v1, DenseVector *v2) {
+    return vec_dot(v1->values, v2->values, v1->size);
+}
 
-            current_pos[col]++;
+// pierwszy wiersz, dla ktorego liczba elementow przed nim (niezerowe plus
+// jeden na wiersz) osiaga target
+static int first_row_with_cost(const int *row_ptr, int rows, long long target) {
+    int lo = 0;
+    int hi = rows;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if ((long long)row_ptr[mid] + mid < target) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
+    return lo;
+}
 
-    free(current_pos);
-    return transpose;
+// Zakres wierszy [begin, end) watku thread sposrod num_threads, dobrany tak,
+// zeby kazdy watek dostal podobna liczbe niezerowych elementow, a nie
+// wierszy - przy skosnym rozkladzie stopni podzial po wierszach zostawia
+// wiekszosc pracy jednemu watkowi. Dwa wyszukiwania binarne na wywolanie.
+void nnz_balanced_row_range(const int *row_ptr, int rows, int thread, int num_threads, int *begin,
+                            int *end) {
+    long long total = (long long)row_ptr[rows] + rows;
+    *begin = first_row_with_cost(row_ptr, rows, total * thread / num_threads);
+    *end = first_row_with_cost(row_ptr, rows, total * (thread + 1) / num_threads);
 }
 
-// funkcja pomocnicza do macierzy sasiedztwa
-SparseMatrix *add_sparse_and_transpose_binary(SparseMatrix *matrix) {
-    if (!matrix) {
-        error("Macierz wejściowa jest NULL.\n");
-        return NULL;
-    }
+int spmv_use_threads(SparseMatrix *matrix) { return matrix->nnz >= SPMV_PARALLEL_MIN_NNZ; }
 
-    SparseMatrix *transpose = transpose_sparse_matrix(matrix);
-    if (!transpose) {
-        error("Nie udało się transponować macierzy.\n");
-        return NULL;
+// minimalny ruch pamieci mnozenia macierzy przez count wektorow: struktura
+// macierzy raz, kazdy wektor wejsciowy i wynikowy raz
+double spmv_traffic_bytes(SparseMatrix *matrix, int count) {
+    double bytes = (matrix->rows + 1.0) * sizeof(int) + (double)matrix->nnz * sizeof(int);
+    if (matrix->values) {
+        bytes += (double)matrix->nnz * sizeof(double);
     }
+    return bytes + 2.0 * count * matrix->rows * sizeof(double);
+}
 
-    SparseMatrix *result = malloc(sizeof(SparseMatrix));
-    if (!result) {
-        error("Nie udało się alokować pamięci dla macierzy z wynikiem.\n");
-        free_sparse_matrix(transpose);
-        return NULL;
-    }
-
-    result->rows = matrix->rows;
-    result->cols = matrix->cols;
-    result->nnz = 0;
-
-    int max_nnz = matrix->nnz + transpose->nnz;
-    double *temp_values = malloc(max_nnz * sizeof(double));
-    int *temp_col_indices = malloc(max_nnz * sizeof(int));
-    int *temp_row_ptr = calloc((matrix->rows + 1), sizeof(int));
-
-    if (!temp_values || !temp_col_indices || !temp_row_ptr) {
-        error("Nie udało się alokować pamięci dla tymczasowych mcierzy.\n");
-        free(temp_values);
-        free(temp_col_indices);
-        free(temp_row_ptr);
-        free_sparse_matrix(transpose);
+void record_spmv(double seconds, double bytes) {
+    spmv_stats.calls++;
+    spmv_stats.seconds += seconds;
+    spmv_stats.bytes += bytes;
+}
 
-        if (result) {
-            free(result);
-        }
+void reset_spmv_stats(void) {
+    spmv_stats.calls = 0;
+    spmv_stats.seconds = 0.0;
+    spmv_stats.bytes = 0.0;
+}
 
-        return NULL;
+SpmvStats get_spmv_stats(void) { return spmv_stats; }
+
+// Jeden wiersz wyniku deg * x - A * x dla panelu w kolumn bloku zapisanego
+// wierszami (wiersz r zaczyna sie od r * ld); przy stalym w petle po
+// kolumnach sa rozwijane do rejestrow.
+static inline __attribute__((always_inline)) void spmm_row_panel(SparseMatrix *adj_matrix,
+                                                                 const double *x, double *y,
+                                                                 int ld, int row, int offset,
+                                                                 int w) {
+    const int *row_ptr = adj_matrix->row_ptr;
+    const int *col_indices = adj_matrix->col_indices;
+    const double *xi = x + (size_t)row * ld + offset;
+    double acc[16];
+
+    double degree = row_ptr[row + 1] - row_ptr[row];
+    for (int c = 0; c < w; c++) {
+        acc[c] = degree * xi[c];
     }
-
-    int temp_nnz = 0;
-    for (int row = 0; row < matrix->rows; row++) {
-        int i = matrix->row_ptr[row];
-        int j = transpose->row_ptr[row];
-
-        while (i < matrix->row_ptr[row + 1] || j < transpose->row_ptr[row + 1]) {
-            int col_i = (i < matrix->row_ptr[row + 1]) ? matrix->col_indices[i] : matrix->cols;
-            int col_j =
-                (j < transpose->row_ptr[row + 1]) ? transpose->col_indices[j] : matrix->cols;
-
-            if (col_i == col_j) {
-                temp_values[temp_nnz] = 1.0;
-                temp_col_indices[temp_nnz] = col_i;
-                i++;
-                j++;
-            } else if (col_i < col_j) {
-                temp_values[temp_nnz] = 1.0;
-                temp_col_indices[temp_nnz] = col_i;
-                i++;
-            } else {
-                temp_values[temp_nnz] = 1.0;
-                temp_col_indices[temp_nnz] = col_j;
-                j++;
-            }
-
-            temp_nnz++;
+    for (int j = row_ptr[row]; j < row_ptr[row + 1]; j++) {
+        const double *xj = x + (size_t)col_indices[j] * ld + offset;
+        for (int c = 0; c < w; c++) {
+            acc[c] -= xj[c];
         }
-
-        temp_row_ptr[row + 1] = temp_nnz;
-    }
-
-    result->values = malloc(temp_nnz * sizeof(double));
-    result->col_indices = malloc(temp_nnz * sizeof(int));
-    result->row_ptr = malloc((matrix->rows + 1) * sizeof(int));
-
-    if (!result->values || !result->col_indices || !result->row_ptr) {
-        error("Nie udało się alokować pamięci dla elementow macierzy "
-              "wynikowej.\n");
-        free(temp_values);
-        free(temp_col_indices);
-        free(temp_row_ptr);
-        free_sparse_matrix(transpose);
-        free_sparse_matrix(result);
-        return NULL;
-    }
-
-    for (int i = 0; i < temp_nnz; i++) {
-        result->values[i] = temp_values[i];
-        result->col_indices[i] = temp_col_indices[i];
     }
-
-    for (int i = 0; i <= matrix->rows; i++) {
-        result->row_ptr[i] = temp_row_ptr[i];
+    double *yi = y + (size_t)row * ld + offset;
+    for (int c = 0; c < w; c++) {
+        yi[c] = acc[c];
     }
-
-    result->nnz = temp_nnz;
-
-    free(temp_values);
-    free(temp_col_indices);
-    free(temp_row_ptr);
-    free_sparse_matrix(transpose);
-
-    return result;
 }
 
-// na podstawie macierzy sasiedzstwa (tej stworzonej z sumy macierzy saiedzstwa
-// i jej transpozycji)!
-SparseMatrix *create_degree_matrix(SparseMatrix *adj_matrix) {
-
-    SparseMatrix *degree_matrix = malloc(sizeof(SparseMatrix));
-    degree_matrix->rows = adj_matrix->rows;
-    degree_matrix->cols = adj_matrix->cols;
-    degree_matrix->nnz = adj_matrix->rows;
-
-    degree_matrix->values = malloc(degree_matrix->nnz * sizeof(double));
-    degree_matrix->col_indices = malloc(degree_matrix->nnz * sizeof(int));
-    degree_matrix->row_ptr = malloc((degree_matrix->rows + 1) * sizeof(int));
-
-    for (int row = 0; row < adj_matrix->rows; row++) {
-        if (row + 1 >= adj_matrix->rows + 1) {
-            error("row_ptr przekracza granice.\n"); // xd
-            return NULL;
+// szerokie bloki sa dzielone na panele 16, 8 i 4 kolumn oraz reszte; wszystkie
+// panele wiersza korzystaja z tych samych, juz wczytanych indeksow kolumn
+static inline __attribute__((always_inline)) void spmm_rows(SparseMatrix *adj_matrix,
+                                                            const double *x, double *y, int width,
+                                                            int ld, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        int offset = 0;
+        for (; width - offset >= 16; offset += 16) {
+            spmm_row_panel(adj_matrix, x, y, ld, i, offset, 16);
+        }
+        if (width - offset >= 8) {
+            spmm_row_panel(adj_matrix, x, y, ld, i, offset, 8);
+            offset += 8;
+        }
+        if (width - offset >= 4) {
+            spmm_row_panel(adj_matrix, x, y, ld, i, offset, 4);
+            offset += 4;
+        }
+        if (offset < width) {
+            spmm_row_panel(adj_matrix, x, y, ld, i, offset, width - offset);
         }
-        int degree = adj_matrix->row_ptr[row + 1] - adj_matrix->row_ptr[row];
-
-        degree_matrix->values[row] = (double)degree;
-        degree_matrix->col_indices[row] = row;
-        degree_matrix->row_ptr[row] = row;
-    }
-
-    degree_matrix->row_ptr[degree_matrix->rows] = degree_matrix->nnz;
-
-    return degree_matrix;
-}
-
-// iloczyn skalarny
-double dot_product(DenseVector *v1, DenseVector *v2) {
-    double result = 0.0;
-
-    for (int i = 0; i < v1->size; ++i) {
-        result += v1->values[i] * v2->values[i];
     }
-
-    return result;
 }
 
-// mnozenie macierzy rzadkiej w csr przez wektor gesty
-void multiply_sparse_matrix_vector(SparseMatrix *matrix, DenseVector *v, DenseVector *result) {
-    for (int i = 0; i < matrix->rows; i++) {
-        result->values[i] = 0.0;
-        for (int j = matrix->row_ptr[i]; j < matrix->row_ptr[i + 1]; j++) {
-            result->values[i] += matrix->values[j] * v->values[matrix->col_indices[j]];
-        }
+// Y = L * X = deg * X - A * X dla symetrycznej macierzy sasiedztwa i bloku
+// width wektorow zapisanego wierszami: element c wiersza r to x[r * ld + c],
+// a ld >= width pozwala mnozyc czesc kolumn wiekszego bloku. Indeksy
+// macierzy sa czytane raz dla calego bloku, a sasiedzi wiersza sa pobierani
+// calymi liniami pamieci podrecznej.
+void multiply_sparse_matrix_block(SparseMatrix *adj_matrix, const double *x, double *y, int width,
+                                  int ld) {
+    double start = omp_get_wtime();
+#pragma omp parallel if (spmv_use_threads(adj_matrix))
+    {
+        int begin, end;
+        nnz_balanced_row_range(adj_matrix->row_ptr, adj_matrix->rows, omp_get_thread_num(),
+                               omp_get_num_threads(), &begin, &end);
+        spmm_rows(adj_matrix, x, y, width, ld, begin, end);
     }
+    record_spmv(omp_get_wtime() - start, spmv_traffic_bytes(adj_matrix, width));
 }
 
 // normalizacja wektora
 void normalize_vector(DenseVector *v) {
-    double norm = 0.0;
-
-    for (int i = 0; i < v->size; ++i) {
-        norm += v->values[i] * v->values[i];
-    }
-
-    norm = sqrt(norm);
+    double norm = vec_nrm2(v->values, v->size);
 
     if (norm == 0.0) {
         error("Norma wektora wynosi 0.\n");
         return;
     }
 
-    for (int i = 0; i < v->size; ++i) {
-        v->values[i] /= norm;
-    }
+    vec_scale(1.0 / norm, v->values, v->size);
 }
 
 void print_eigenvectors(DenseVector **eigenvectors, int num_eigenvectors) {
@@ -262,3 +189,100 @@ void free_eigenvectors(DenseVector **eigenvectors, int num_eigenvectors) {
     free(eigenvectors);
     eigenvectors = NULL;
 }
+
+// Rozklad wlasny malej, gestej macierzy symetrycznej (n x n, zapisanej
+// wierszami) cykliczna metoda Jacobiego. Wartosci wlasne sa zwracane rosnaco,
+// a odpowiadajace im wektory w kolumnach eigenvectors (tez n x n, wierszami).
+int symmetric_eigen_decomposition(const double *matrix, int n, double *eigenvalues,
+                                  double *eigenvectors) {
+    double *a = malloc((size_t)n * n * sizeof(double));
+    double *v = malloc((size_t)n * n * sizeof(double));
+    int *order = malloc(n * sizeof(int));
+    if (!a || !v || !order) {
+        error("Nie udało się zaalokować pamięci dla rozkładu własnego.\n");
+        free(a);
+        free(v);
+        free(order);
+        return 0;
+    }
+
+    double norm = 0.0;
+    for (int i = 0; i < n * n; i++) {
+        a[i] = matrix[i];
+        norm += a[i] * a[i];
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            v[i * n + j] = (i == j) ? 1.0 : 0.0;
+        }
+    }
+
+    for (int sweep = 0; sweep < 100; sweep++) {
+        double off = 0.0;
+        for (int p = 0; p < n; p++) {
+            for (int q = p + 1; q < n; q++) {
+                off += a[p * n + q] * a[p * n + q];
+            }
+        }
+        if (off <= 1e-30 * norm) {
+            break;
+        }
+
+        for (int p = 0; p < n; p++) {
+            for (int q = p + 1; q < n; q++) {
+                double apq = a[p * n + q];
+                if (fabs(apq) < 1e-300) {
+                    continue;
+                }
+                double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for (int k = 0; k < n; k++) {
+                    double akp = a[k * n + p];
+                    double akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < n; k++) {
+                    double apk = a[p * n + k];
+                    double aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < n; k++) {
+                    double vkp = v[k * n + p];
+                    double vkq = v[k * n + q];
+                    v[k * n + p] = c * vkp - s * vkq;
+                    v[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    // sortowanie przez wstawianie - n jest male
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    for (int i = 1; i < n; i++) {
+        int idx = order[i];
+        int j = i - 1;
+        while (j >= 0 && a[order[j] * n + order[j]] > a[idx * n + idx]) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = idx;
+    }
+    for (int i = 0; i < n; i++) {
+        eigenvalues[i] = a[order[i] * n + order[i]];
+        for (int k = 0; k < n; k++) {
+            eigenvectors[k * n + i] = v[k * n + order[i]];
+        }
+    }
+
+    free(a);
+    free(v);
+    free(order);
+    return 1;
+}
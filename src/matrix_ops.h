@@ -2,22 +2,31 @@
 #define MATRIX_OPS_H
 #include "graph.h"
 
-SparseMatrix *
-transpose_sparse_matrix(SparseMatrix *matrix); // fcja pomocnicza do macierzy sasiedztwa
-SparseMatrix *add_sparse_and_transpose_binary(SparseMatrix *matrix); // stad macierz sasiedztwa
-SparseMatrix *
-create_degree_matrix(SparseMatrix *adj_matrix); // na podstawie macierzy sasiedzstwa (tej stworzonej
-                                                // z sumy macierzy saiedzstwa i jej transpozycji)!
-
 typedef struct {
     int size;       // Rozmiar wektora
     double *values; // Wartosci wektora
 } DenseVector;
 
+typedef struct {
+    long long calls; // Liczba mnozen macierzy rzadkiej przez wektor (lub blok)
+    double seconds;  // Laczny czas tych mnozen
+    double bytes;    // Minimalny ruch pamieci tych mnozen
+} SpmvStats;
+
 double dot_product(DenseVector *v1, DenseVector *v2);
-void multiply_sparse_matrix_vector(SparseMatrix *matrix, DenseVector *v, DenseVector *result);
+void nnz_balanced_row_range(const int *row_ptr, int rows, int thread, int num_threads, int *begin,
+                            int *end);
+int spmv_use_threads(SparseMatrix *matrix);
+double spmv_traffic_bytes(SparseMatrix *matrix, int count);
+void record_spmv(double seconds, double bytes);
+void reset_spmv_stats(void);
+SpmvStats get_spmv_stats(void);
+void multiply_sparse_matrix_block(SparseMatrix *adj_matrix, const double *x, double *y, int width,
+                                  int ld);
 void normalize_vector(DenseVector *v);
 void print_eigenvectors(DenseVector **eigenvectors, int num_eigenvectors);
 void free_eigenvectors(DenseVector **eigenvectors, int num_eigenvectors);
+int symmetric_eigen_decomposition(const double *matrix, int n, double *eigenvalues,
+                                  double *eigenvectors);
 
 #endif
@@ -1,10 +1,27 @@
 #include "partitioner.h"
+#include "chebyshev.h"
+#include "coarsen.h"
+#include "io_handler.h"
+#include "lanczos.h"
+#include "lobpcg.h"
 #include "log_utils.h"
 #include "printfcolor.h"
+#include "refine.h"
+#include "rng.h"
+#include "reorder.h"
 #include <limits.h>
+#include <omp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#define MULTILEVEL_MAX_LEVELS 40
+#define MULTILEVEL_MIN_COARSEST 200          // najmniejszy docelowy rozmiar najgrubszego grafu
+#define MULTILEVEL_COARSEST_PER_PART 30      // docelowa liczba wierzcholkow na partycje
+#define MULTILEVEL_MIN_REDUCTION 0.95        // zgrubianie przerywane, gdy graf maleje slabiej
+#define MULTILEVEL_MAX_VERTEX_WEIGHT 1.5     // wzgledem sredniej wagi na najgrubszym poziomie
+#define MULTILEVEL_COARSE_IMBALANCE_SLACK 0.05 // luz dla ciezkich wierzcholkow, znosi go rafinacja
 
 PartitionResult *create_partition_result(Graph *graph, int num_parts) {
     if (!graph || num_parts <= 0) {
@@ -66,89 +83,344 @@ float get_minimum_achievable_imbalance(int num_vertices, int num_parts) {
     return (float)max_part_size / ideal_size;
 }
 
-PartitionResult *spectral_partition(Graph *graph, int num_parts, float max_imbalance,
-                                    int num_attempts) {
-    float min_achievable_imbalance =
-        get_minimum_achievable_imbalance(graph->num_vertices, num_parts);
-    if (min_achievable_imbalance > max_imbalance) {
-        error("Maksymalny współczynnik nierównowagi %.2f jest niemożliwy do osiągnięcia.\n",
-              max_imbalance);
-        error("Najmniejszy możliwy współczynnik nierównowagi dla %d wierzchołków i %d partycji to "
-              "%.5f\n",
-              graph->num_vertices, num_parts, min_achievable_imbalance);
-        return NULL;
+typedef struct {
+    int cut_edges;   // Liczba krawedzi przecietych w probie
+    float imbalance; // Nierownowaga po rafinacji
+    int iterations;  // Iteracje k-srednich do zbieznosci
+} AttemptScore;
+
+// porzadek wynikow prob: najpierw mieszczace sie w max_imbalance, wsrod nich
+// mniej przecietych krawedzi, mniejsza nierownowaga, nizszy numer proby; wsrod
+// niemieszczacych sie najpierw mniejsza nierownowaga
+static int better_attempt(PartitionResult *result, int attempt, PartitionResult *best,
+                          int best_attempt, float max_imbalance) {
+    if (!best) {
+        return 1;
     }
-    SparseMatrix *matrix = create_adjacency_matrix(graph);
-    SparseMatrix *temp = add_sparse_and_transpose_binary(matrix);
-    if (!temp) {
-        error("Nie udało się przetworzyć macierzy sąsiedztwa.\n");
-        free_sparse_matrix(matrix);
+    int balanced = result->imbalance <= max_imbalance;
+    if (balanced != (best->imbalance <= max_imbalance)) {
+        return balanced;
     }
+    if (!balanced && result->imbalance != best->imbalance) {
+        return result->imbalance < best->imbalance;
+    }
+    if (result->cut_edges != best->cut_edges) {
+        return result->cut_edges < best->cut_edges;
+    }
+    if (result->imbalance != best->imbalance) {
+        return result->imbalance < best->imbalance;
+    }
+    return attempt < best_attempt;
+}
 
-    free_sparse_matrix(matrix);
-    matrix = temp;
-
-    verbose("Tworzenie macierzy Laplace'a ");
-    fflush(stdout);
-    SparseMatrix *laplacian = build_laplacian_matrix(matrix);
-    printfc_fg(GREY, "skończone.\n");
+// Wektory wlasne i k-srednie na calym grafie; krawedzie grafow zgrubionych
+// sa traktowane w laplasjanie jako jednostkowe, a ich wagi uwzglednia
+// dopiero rafinacja. Gdy zadna proba nie miesci sie w max_imbalance, zwraca
+// NULL, chyba ze keep_imbalanced - wtedy najlepsza z prob (na grubym
+// poziomie rownowage przywraca rafinacja na drobniejszych).
+static PartitionResult *partition_graph_spectrally(Graph *graph, Config *config,
+                                                   int keep_imbalanced) {
+    int num_parts = config->num_parts;
+    float max_imbalance = config->max_imbalance;
+    int num_attempts = config->num_attempts;
+
+    SparseMatrix *matrix = create_adjacency_view(graph);
+    if (!matrix) {
+        error("Nie udało się przetworzyć macierzy sąsiedztwa.\n");
+        return NULL;
+    }
 
     int num_eigenvectors = num_parts - 1;
+    DenseVector **eigenvectors;
+    EigensolverStats stats = {0};
+    Preconditioner *precond = NULL;
+    struct timespec start, stop;
+    reset_spmv_stats();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (config->eigensolver == EIGENSOLVER_LOBPCG) {
+        precond = create_preconditioner(matrix, config->preconditioner);
+    }
     verbose("Przetwarzanie wektorów własnych ");
     fflush(stdout);
-    DenseVector **eigenvectors = compute_eigenvectors(laplacian, num_eigenvectors);
+    if (config->eigensolver == EIGENSOLVER_LANCZOS) {
+        eigenvectors = compute_eigenvectors_lanczos(matrix, num_eigenvectors, &stats);
+    } else if (config->eigensolver == EIGENSOLVER_LOBPCG) {
+        eigenvectors = compute_eigenvectors_lobpcg(matrix, num_eigenvectors, precond, &stats);
+    } else if (config->eigensolver == EIGENSOLVER_CHEBYSHEV) {
+        eigenvectors = compute_eigenvectors_chebyshev(matrix, num_eigenvectors, &stats);
+    } else {
+        eigenvectors = compute_eigenvectors(matrix, num_eigenvectors);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    free_preconditioner(precond);
     printfc_fg(GREY, "skończone.\n");
-
-    double **spectral_points = malloc(graph->num_vertices * sizeof(double *));
-    for (int i = 0; i < graph->num_vertices; i++) {
-        spectral_points[i] = malloc(num_eigenvectors * sizeof(double));
-        for (int j = 0; j < num_eigenvectors; j++) {
-            spectral_points[i][j] = eigenvectors[j]->values[i];
+    if (!eigenvectors) {
+        error("Nie udało się wyznaczyć wektorów własnych.\n");
+        free_sparse_matrix(matrix);
+        return NULL;
+    }
+    verbose("Wektory własne wyznaczone w %.3f s\n",
+            (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) * 1e-9);
+    SpmvStats spmv = get_spmv_stats();
+    if (spmv.seconds > 0) {
+        verbose("Mnożenia macierzy rzadkiej: %lld w %.3f s (%.2f GB/s, wątki: %d)\n", spmv.calls,
+                spmv.seconds, spmv.bytes / spmv.seconds * 1e-9, omp_get_max_threads());
+    }
+    if (config->eigensolver != EIGENSOLVER_POWER) {
+        verbose("Mnożenia przez macierz: %d, iteracje zewnętrzne: %d, max. residuum: %.2e\n",
+                stats.iterations, stats.restarts, stats.max_residual);
+        if (stats.converged < num_eigenvectors) {
+            warn("Zbieżność osiągnęło %d z %d wektorów własnych.\n", stats.converged,
+                 num_eigenvectors);
         }
     }
-    PartitionResult *best_result = NULL;
-    int min_cut_edges = INT_MAX;
-
-    for (int attempt = 0; attempt < num_attempts; attempt++) {
-        int *clusters =
-            kmeans_clustering(spectral_points, graph->num_vertices, num_eigenvectors, num_parts);
 
-        PartitionResult *current_result = create_partition_result(graph, num_parts);
-        for (int i = 0; i < graph->num_vertices; i++) {
-            current_result->partition[i] = clusters[i];
+    double *spectral_points =
+        create_spectral_embedding(eigenvectors, num_eigenvectors, graph->num_vertices);
+    free_eigenvectors(eigenvectors, num_eigenvectors);
+    if (!spectral_points) {
+        free_sparse_matrix(matrix);
+        return NULL;
+    }
+    // Proby sa niezalezne: kazda losuje ze strumienia wyznaczonego przez
+    // ziarno i swoj numer, a najlepszy wynik wybierany jest po liczbie
+    // przecietych krawedzi, potem nierownowadze, potem numerze proby, wiec
+    // nie zalezy od liczby watkow
+    AttemptScore *scores = malloc((num_attempts > 0 ? num_attempts : 1) * sizeof(AttemptScore));
+    if (!scores) {
+        error("Nie udało się zaalokować pamięci dla wyników prób.\n");
+        num_attempts = 0;
+    }
+    PartitionResult *best_result = NULL;
+    int best_attempt = -1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Gdy prob jest mniej niz watkow, proby ida po kolei, a watki dzieli
+    // miedzy siebie k-srednich wewnatrz jednej proby
+    int attempt_threads = omp_get_max_threads();
+    if (num_attempts < attempt_threads) {
+        attempt_threads = 1;
+    }
+#pragma omp parallel num_threads(attempt_threads) if (attempt_threads > 1)
+    {
+        PartitionResult *local_best = NULL;
+        int local_attempt = -1;
+
+#pragma omp for schedule(dynamic, 1)
+        for (int attempt = 0; attempt < num_attempts; attempt++) {
+            scores[attempt].cut_edges = INT_MAX;
+            scores[attempt].iterations = 0;
+            RngState rng;
+            rng_init(&rng, config->seed, attempt);
+            int *clusters =
+                kmeans_clustering(spectral_points, graph->num_vertices, num_eigenvectors,
+                                  num_parts, config, &rng, &scores[attempt].iterations);
+            PartitionResult *current_result =
+                clusters ? create_partition_result(graph, num_parts) : NULL;
+            if (!current_result) {
+                free(clusters);
+                continue;
+            }
+            memcpy(current_result->partition, clusters, graph->num_vertices * sizeof(int));
+            free(clusters);
+
+            optimize_partition(graph, current_result, max_imbalance, config->refine,
+                               config->refine_passes);
+            calculate_cut_edges(graph, current_result);
+            calculate_imbalance(current_result);
+            scores[attempt].cut_edges = current_result->cut_edges;
+            scores[attempt].imbalance = current_result->imbalance;
+
+            if ((keep_imbalanced || current_result->imbalance <= max_imbalance) &&
+                better_attempt(current_result, attempt, local_best, local_attempt,
+                               max_imbalance)) {
+                free_partition_result(local_best);
+                local_best = current_result;
+                local_attempt = attempt;
+            } else {
+                free_partition_result(current_result);
+            }
         }
 
-        optimize_partition(graph, current_result, max_imbalance);
-        calculate_cut_edges(graph, current_result);
-        calculate_imbalance(current_result);
-
-        if (current_result->cut_edges < min_cut_edges &&
-            current_result->imbalance <= max_imbalance) {
-            if (best_result) {
+#pragma omp critical(best_partition)
+        {
+            if (local_best && better_attempt(local_best, local_attempt, best_result, best_attempt,
+                                             max_imbalance)) {
                 free_partition_result(best_result);
+                best_result = local_best;
+                best_attempt = local_attempt;
+            } else {
+                free_partition_result(local_best);
             }
-            best_result = current_result;
-            min_cut_edges = current_result->cut_edges;
+        }
+    }
+
+    int min_cut_edges = INT_MAX;
+    long total_iterations = 0;
+    for (int attempt = 0; attempt < num_attempts; attempt++) {
+        total_iterations += scores[attempt].iterations;
+        if (scores[attempt].cut_edges < min_cut_edges &&
+            scores[attempt].imbalance <= max_imbalance) {
+            min_cut_edges = scores[attempt].cut_edges;
             verbose("Znaleziono lepsze rozwiązanie: przecięte krawędzie = %d, nierównowaga = %.2f\n",
-                 min_cut_edges, current_result->imbalance);
-        } else {
-            free_partition_result(current_result);
+                    min_cut_edges, scores[attempt].imbalance);
         }
-        free(clusters);
     }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    if (num_attempts > 0) {
+        verbose("Próby podziału: %d w %.3f s, średnia liczba iteracji k-średnich: %.1f\n",
+                num_attempts, (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) * 1e-9,
+                (double)total_iterations / num_attempts);
+    }
+    free(scores);
 
     free_sparse_matrix(matrix);
-    free_sparse_matrix(laplacian);
-    free_eigenvectors(eigenvectors, num_eigenvectors);
-    for (int i = 0; i < graph->num_vertices; i++) {
-        free(spectral_points[i]);
-    }
     free(spectral_points);
 
     return best_result;
 }
 
-void optimize_partition(Graph *graph, PartitionResult *result, float max_imbalance) {
+// Tryb wielopoziomowy: graf jest zgrubiany dopasowaniem ciezkich krawedzi az
+// do kilkudziesieciu wierzcholkow na partycje, najgrubszy poziom dzielony jest
+// spektralnie, a podzial jest rzutowany z powrotem poziom po poziomie z
+// rafinacja na kazdym z nich
+static PartitionResult *multilevel_partition(Graph *graph, Config *config) {
+    int num_parts = config->num_parts;
+    int target = MULTILEVEL_COARSEST_PER_PART * num_parts;
+    if (target < MULTILEVEL_MIN_COARSEST) {
+        target = MULTILEVEL_MIN_COARSEST;
+    }
+    int max_vertex_weight =
+        (int)(MULTILEVEL_MAX_VERTEX_WEIGHT * total_vertex_weight(graph) / target);
+    if (max_vertex_weight < 2) {
+        max_vertex_weight = 2;
+    }
+
+    Graph *levels[MULTILEVEL_MAX_LEVELS];
+    int *cmaps[MULTILEVEL_MAX_LEVELS];
+    int num_levels = 1;
+    levels[0] = graph;
+    while (levels[num_levels - 1]->num_vertices > target && num_levels < MULTILEVEL_MAX_LEVELS) {
+        Graph *fine = levels[num_levels - 1];
+        int *cmap = malloc(fine->num_vertices * sizeof(int));
+        Graph *coarse = cmap ? coarsen_graph(fine, cmap, max_vertex_weight) : NULL;
+        if (!coarse || coarse->num_vertices > MULTILEVEL_MIN_REDUCTION * fine->num_vertices) {
+            free(cmap);
+            free_memory(coarse);
+            break;
+        }
+        cmaps[num_levels - 1] = cmap;
+        levels[num_levels++] = coarse;
+        verbose("Poziom %d: %d wierzchołków, %d krawędzi\n", num_levels - 1,
+                coarse->num_vertices, coarse->num_edges);
+    }
+
+    Config coarse_config = *config;
+    if (num_levels > 1) {
+        coarse_config.max_imbalance += MULTILEVEL_COARSE_IMBALANCE_SLACK;
+    }
+    PartitionResult *result =
+        partition_graph_spectrally(levels[num_levels - 1], &coarse_config, num_levels > 1);
+
+    for (int l = num_levels - 2; l >= 0 && result; l--) {
+        PartitionResult *fine_result = create_partition_result(levels[l], num_parts);
+        if (fine_result) {
+            for (int v = 0; v < levels[l]->num_vertices; v++) {
+                fine_result->partition[v] = result->partition[cmaps[l][v]];
+            }
+            optimize_partition(levels[l], fine_result, config->max_imbalance, config->refine,
+                               config->refine_passes);
+        }
+        free_partition_result(result);
+        result = fine_result;
+    }
+
+    for (int l = 1; l < num_levels; l++) {
+        free_memory(levels[l]);
+        free(cmaps[l - 1]);
+    }
+    if (!result) {
+        return NULL;
+    }
+
+    calculate_cut_edges(graph, result);
+    calculate_imbalance(result);
+    if (result->imbalance > config->max_imbalance) {
+        warn("Podział wielopoziomowy ma nierównowagę %.2f większą od dozwolonej.\n",
+             result->imbalance);
+    }
+    return result;
+}
+
+// Podzial na kopii grafu z wierzcholkami przenumerowanymi dla lepszej
+// lokalnosci dostepu do pamieci; wynik wraca do numeracji wejsciowej
+static PartitionResult *reordered_partition(Graph *graph, Config *config) {
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int *perm = compute_vertex_ordering(graph, config->reorder);
+    Graph *permuted = perm ? permute_graph(graph, perm) : NULL;
+    if (!permuted) {
+        free(perm);
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    // szerokosc pasma wymaga przejscia po calym grafie, wiec tylko w trybie szczegolowym
+    if (config->verbose) {
+        verbose("Przenumerowanie wierzchołków w %.3f s, szerokość pasma: %d -> %d\n",
+                (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) * 1e-9,
+                graph_bandwidth(graph), graph_bandwidth(permuted));
+    }
+
+    Config inner = *config;
+    inner.reorder = REORDER_NONE;
+    PartitionResult *result = spectral_partition(permuted, &inner);
+    free_memory(permuted);
+    if (!result) {
+        free(perm);
+        return NULL;
+    }
+
+    int *partition = malloc(graph->num_vertices * sizeof(int));
+    if (!partition) {
+        error("Nie udało się zaalokować pamięci dla partycji.\n");
+        free(perm);
+        free_partition_result(result);
+        return NULL;
+    }
+    for (int i = 0; i < graph->num_vertices; i++) {
+        partition[perm[i]] = result->partition[i];
+    }
+    free(result->partition);
+    result->partition = partition;
+    free(perm);
+    return result;
+}
+
+PartitionResult *spectral_partition(Graph *graph, Config *config) {
+    float min_achievable_imbalance =
+        get_minimum_achievable_imbalance(graph->num_vertices, config->num_parts);
+    if (min_achievable_imbalance > config->max_imbalance) {
+        error("Maksymalny współczynnik nierównowagi %.2f jest niemożliwy do osiągnięcia.\n",
+              config->max_imbalance);
+        error("Najmniejszy możliwy współczynnik nierównowagi dla %d wierzchołków i %d partycji to "
+              "%.5f\n",
+              graph->num_vertices, config->num_parts, min_achievable_imbalance);
+        return NULL;
+    }
+
+    if (config->reorder != REORDER_NONE) {
+        return reordered_partition(graph, config);
+    }
+    if (config->multilevel) {
+        return multilevel_partition(graph, config);
+    }
+    return partition_graph_spectrally(graph, config, 0);
+}
+
+// rozmiary partycji sa sumami wag wierzcholkow, a zysk z przeniesienia
+// sumami wag krawedzi (w grafie wejsciowym wszystkie wagi sa rowne 1)
+void optimize_partition(Graph *graph, PartitionResult *result, float max_imbalance,
+                        RefineType refine, int passes) {
     if (!graph || !result) {
         error("Niepoprawne dane wejściowe do optimize_partition.\n");
         return;
@@ -158,7 +430,8 @@ void optimize_partition(Graph *graph, PartitionResult *result, float max_imbalan
     int num_parts = result->num_parts;
     int *partition = result->partition;
     int *part_sizes = result->part_sizes;
-    int ideal_size = num_vertices / num_parts;
+    int *vwgt = graph->vwgt;
+    int ideal_size = total_vertex_weight(graph) / num_parts;
     int max_allowed_size = (int)(ideal_size * max_imbalance);
 
     memset(part_sizes, 0, num_parts * sizeof(int));
@@ -168,81 +441,14 @@ void optimize_partition(Graph *graph, PartitionResult *result, float max_imbalan
             error("Niepoprawny indeks partycji dla wierzchołka %d.\n", i);
             return;
         }
-        part_sizes[partition[i]]++;
+        part_sizes[partition[i]] += vwgt ? vwgt[i] : 1;
     }
 
-    for (int p = 0; p < num_parts; p++) {
-        while (part_sizes[p] > max_allowed_size) {
-            // znajdz wierzcholek do przesuniecia
-            for (int v = 0; v < num_vertices; v++) {
-                if (partition[v] == p) {
-                    for (int other_p = 0; other_p < num_parts; other_p++) {
-                        if (other_p != p && part_sizes[other_p] < max_allowed_size) {
-                            partition[v] = other_p;
-                            part_sizes[p]--;
-                            part_sizes[other_p]++;
-                            break;
-                        }
-                    }
-                    if (part_sizes[p] <= max_allowed_size) {
-                        break;
-                    }
-                }
-            }
-        }
-    }
-
-    int improved = 1;
-    while (improved) {
-        improved = 0;
-
-        for (int v = 0; v < num_vertices; v++) {
-            int current_part = partition[v];
-            int best_part = current_part;
-            int min_cut_increase = 0;
-
-            for (int p = 0; p < num_parts; p++) {
-                if (p == current_part) {
-                    continue;
-                }
-
-                if (part_sizes[p] + 1 > max_allowed_size) {
-                    continue;
-                }
-
-                int cut_increase = 0;
-                if (graph->edge_groups[v] == NULL) {
-                    continue;
-                }
-
-                for (int i = 0; i < graph->group_sizes[v]; i++) {
-                    int neighbor = graph->edge_groups[v][i];
-                    if (neighbor < 0 || neighbor >= num_vertices) {
-                        error("Niepoprawny sąsiad dla wierzchołka %d.\n", v);
-                        return;
-                    }
-
-                    if (partition[neighbor] == p) {
-                        cut_increase--;
-                    } else if (partition[neighbor] == current_part) {
-                        cut_increase++;
-                    }
-                }
-
-                if (cut_increase < min_cut_increase) {
-                    min_cut_increase = cut_increase;
-                    best_part = p;
-                }
-            }
-
-            // jesli lepsza czesc to zmieniamy
-            if (best_part != current_part) {
-                partition[v] = best_part;
-                part_sizes[current_part]--;
-                part_sizes[best_part]++;
-                improved = 1;
-            }
-        }
+    fm_balance(graph, result, max_allowed_size);
+    if (refine == REFINE_LABEL_PROPAGATION) {
+        lp_refine(graph, result, max_allowed_size, passes);
+    } else {
+        fm_refine(graph, result, max_allowed_size, passes);
     }
 }
 
@@ -254,36 +460,35 @@ void calculate_cut_edges(Graph *graph, PartitionResult *result) {
 
     int cut_edges = 0;
     for (int v = 0; v < graph->num_vertices; v++) {
-        if (graph->edge_groups[v] == NULL) {
-            continue;
-        }
-
-        for (int i = 0; i < graph->group_sizes[v]; i++) {
-            int neighbor = graph->edge_groups[v][i];
+        for (int i = graph->xadj[v]; i < graph->xadj[v + 1]; i++) {
+            int neighbor = graph->adjncy[i];
             if (result->partition[v] != result->partition[neighbor]) {
-                cut_edges++;
+                cut_edges += graph->adjwgt ? graph->adjwgt[i] : 1;
             }
         }
     }
     result->cut_edges = cut_edges / 2;
 }
 
+// part_sizes musza byc aktualne (ustawia je optimize_partition); ich suma to
+// calkowita waga wierzcholkow
 void calculate_imbalance(PartitionResult *result) {
     if (!result) {
         error("Niepoprawne dane wejściowe do calculate_imbalance.\n");
         return;
     }
 
-    int total_vertices = result->num_vertices;
+    int total_weight = 0;
     int num_parts = result->num_parts;
-    int ideal_size = total_vertices / num_parts;
     int max_size = 0;
 
     for (int p = 0; p < num_parts; p++) {
+        total_weight += result->part_sizes[p];
         if (result->part_sizes[p] > max_size) {
             max_size = result->part_sizes[p];
         }
     }
+    int ideal_size = total_weight / num_parts;
     result->imbalance = (float)max_size / ideal_size;
 }
 
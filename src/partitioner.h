@@ -1,5 +1,6 @@
 #ifndef PARTITIONER_H
 #define PARTITIONER_H
+#include "args_parser.h"
 #include "graph.h"
 #include "matrix_ops.h"
 #include "spectral_algorithm.h"
@@ -15,11 +16,11 @@ typedef struct {
 
 PartitionResult *create_partition_result(Graph *graph, int num_parts);
 void free_partition_result(PartitionResult *result);
-PartitionResult *spectral_partition(Graph *graph, int num_parts, float max_imbalance,
-                                    int num_attempts);
+PartitionResult *spectral_partition(Graph *graph, Config *config);
 void calculate_cut_edges(Graph *graph, PartitionResult *result);
 void calculate_imbalance(PartitionResult *result);
-void optimize_partition(Graph *graph, PartitionResult *result, float max_imbalance);
+void optimize_partition(Graph *graph, PartitionResult *result, float max_imbalance,
+                        RefineType refine, int passes);
 void print_partition_result(PartitionResult *result);
 float get_minimum_achievable_imbalance(int num_vertices, int num_parts);
 
@@ -0,0 +1,394 @@
+#include "preconditioner.h"
+#include "log_utils.h"
+#include "matrix_ops.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MULTIGRID_MAX_LEVELS 30
+#define MULTIGRID_COARSEST_SIZE 64     // ponizej tej liczby wierzcholkow koniec zgrubiania
+#define MULTIGRID_MIN_COARSENING 0.8   // zgrubianie przerywane, gdy poziom maleje slabiej
+#define MULTIGRID_DIRECT_SIZE 128      // najgrubszy poziom rozwiazywany pseudoodwrotnoscia
+#define MULTIGRID_SMOOTHING_SWEEPS 2
+#define MULTIGRID_COARSE_SWEEPS 20     // gdy najgrubszy poziom jest za duzy na rozklad
+#define MULTIGRID_JACOBI_WEIGHT 0.6667
+
+static void apply_jacobi(Preconditioner *self, const double *r, double *z) {
+    for (int i = 0; i < self->n; i++) {
+        z[i] = self->inv_diag[i] * r[i];
+    }
+}
+
+// out = r - L x dla macierzy Laplace'a poziomu
+static void level_residual(MultigridLevel *level, const double *x, const double *r, double *out) {
+    for (int i = 0; i < level->n; i++) {
+        double sum = level->diag[i] * x[i];
+        for (int j = level->row_ptr[i]; j < level->row_ptr[i + 1]; j++) {
+            double weight = level->values ? level->values[j] : 1.0;
+            sum -= weight * x[level->col_indices[j]];
+        }
+        out[i] = r[i] - sum;
+    }
+}
+
+// wazona metoda Jacobiego: x += w * D^-1 (r - L x)
+static void smooth(MultigridLevel *level, int sweeps) {
+    for (int s = 0; s < sweeps; s++) {
+        level_residual(level, level->x, level->r, level->tmp);
+        for (int i = 0; i < level->n; i++) {
+            double d = level->diag[i] > 0.0 ? level->diag[i] : 1.0;
+            level->x[i] += MULTIGRID_JACOBI_WEIGHT * level->tmp[i] / d;
+        }
+    }
+}
+
+static void v_cycle(Preconditioner *self, int l) {
+    MultigridLevel *level = &self->levels[l];
+    memset(level->x, 0, level->n * sizeof(double));
+
+    if (l == self->num_levels - 1) {
+        if (self->coarse_pinv) {
+            for (int i = 0; i < level->n; i++) {
+                double sum = 0.0;
+                for (int j = 0; j < level->n; j++) {
+                    sum += self->coarse_pinv[(size_t)i * level->n + j] * level->r[j];
+                }
+                level->x[i] = sum;
+            }
+        } else {
+            smooth(level, MULTIGRID_COARSE_SWEEPS);
+        }
+        return;
+    }
+
+    MultigridLevel *coarse = &self->levels[l + 1];
+    smooth(level, MULTIGRID_SMOOTHING_SWEEPS);
+    level_residual(level, level->x, level->r, level->tmp);
+    memset(coarse->r, 0, coarse->n * sizeof(double));
+    for (int i = 0; i < level->n; i++) {
+        coarse->r[level->aggregate[i]] += level->tmp[i];
+    }
+
+    v_cycle(self, l + 1);
+
+    for (int i = 0; i < level->n; i++) {
+        level->x[i] += coarse->x[level->aggregate[i]];
+    }
+    smooth(level, MULTIGRID_SMOOTHING_SWEEPS);
+}
+
+static void apply_multigrid(Preconditioner *self, const double *r, double *z) {
+    memcpy(self->levels[0].r, r, self->n * sizeof(double));
+    v_cycle(self, 0);
+    memcpy(z, self->levels[0].x, self->n * sizeof(double));
+}
+
+// Agregacja w trzech fazach: wierzcholek, ktorego zaden sasiad nie jest
+// jeszcze przydzielony, tworzy agregat z cala swoja okolica; pozostale
+// dolaczaja do agregatu sasiada, a te bez przydzielonych sasiadow tworza
+// agregat z nieprzydzielonymi sasiadami. Zwraca liczbe agregatow.
+static int build_aggregates(MultigridLevel *level) {
+    int n = level->n;
+    int *aggregate = level->aggregate;
+    int count = 0;
+
+    for (int i = 0; i < n; i++) {
+        aggregate[i] = -1;
+    }
+    for (int i = 0; i < n; i++) {
+        int free_neighborhood = 1;
+        for (int j = level->row_ptr[i]; j < level->row_ptr[i + 1]; j++) {
+            if (aggregate[level->col_indices[j]] >= 0) {
+                free_neighborhood = 0;
+                break;
+            }
+        }
+        if (aggregate[i] >= 0 || !free_neighborhood) {
+            continue;
+        }
+        aggregate[i] = count;
+        for (int j = level->row_ptr[i]; j < level->row_ptr[i + 1]; j++) {
+            aggregate[level->col_indices[j]] = count;
+        }
+        count++;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (aggregate[i] >= 0) {
+            continue;
+        }
+        for (int j = level->row_ptr[i]; j < level->row_ptr[i + 1]; j++) {
+            // -2 oznacza dolaczonych w tej fazie, zeby agregaty nie rosly lancuchowo
+            int neighbor_aggregate = aggregate[level->col_indices[j]];
+            if (neighbor_aggregate >= 0) {
+                aggregate[i] = -2 - neighbor_aggregate;
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (aggregate[i] <= -2) {
+            aggregate[i] = -2 - aggregate[i];
+        } else if (aggregate[i] == -1) {
+            aggregate[i] = count;
+            for (int j = level->row_ptr[i]; j < level->row_ptr[i + 1]; j++) {
+                if (aggregate[level->col_indices[j]] == -1) {
+                    aggregate[level->col_indices[j]] = count;
+                }
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+static int alloc_level_vectors(MultigridLevel *level) {
+    level->r = malloc(level->n * sizeof(double));
+    level->x = malloc(level->n * sizeof(double));
+    level->tmp = malloc(level->n * sizeof(double));
+    return level->r && level->x && level->tmp;
+}
+
+// macierz Galerkina P^T L P dla agregacji bez wygladzania: wagi krawedzi
+// miedzy agregatami to sumy wag krawedzi miedzy ich wierzcholkami
+static int build_coarse_level(MultigridLevel *fine, MultigridLevel *coarse, int num_aggregates) {
+    int nc = num_aggregates;
+    int nnz_bound = fine->row_ptr[fine->n];
+    int *member_ptr = calloc(nc + 1, sizeof(int));
+    int *members = malloc(fine->n * sizeof(int));
+    int *position = malloc(nc * sizeof(int));
+
+    coarse->n = nc;
+    coarse->owns_matrix = 1;
+    coarse->row_ptr = malloc((nc + 1) * sizeof(int));
+    coarse->col_indices = malloc((nnz_bound > 0 ? nnz_bound : 1) * sizeof(int));
+    coarse->values = malloc((nnz_bound > 0 ? nnz_bound : 1) * sizeof(double));
+    coarse->diag = calloc(nc, sizeof(double));
+    if (!member_ptr || !members || !position || !coarse->row_ptr || !coarse->col_indices ||
+        !coarse->values || !coarse->diag || !alloc_level_vectors(coarse)) {
+        free(member_ptr);
+        free(members);
+        free(position);
+        return 0;
+    }
+
+    for (int i = 0; i < fine->n; i++) {
+        member_ptr[fine->aggregate[i] + 1]++;
+    }
+    for (int c = 0; c < nc; c++) {
+        member_ptr[c + 1] += member_ptr[c];
+        position[c] = -1;
+    }
+    for (int i = 0; i < fine->n; i++) {
+        members[member_ptr[fine->aggregate[i]]++] = i;
+    }
+    for (int c = nc; c > 0; c--) {
+        member_ptr[c] = member_ptr[c - 1];
+    }
+    member_ptr[0] = 0;
+
+    int nnz = 0;
+    coarse->row_ptr[0] = 0;
+    for (int c = 0; c < nc; c++) {
+        int row_start = nnz;
+        for (int m = member_ptr[c]; m < member_ptr[c + 1]; m++) {
+            int v = members[m];
+            for (int j = fine->row_ptr[v]; j < fine->row_ptr[v + 1]; j++) {
+                int d = fine->aggregate[fine->col_indices[j]];
+                if (d == c) {
+                    continue;
+                }
+                double weight = fine->values ? fine->values[j] : 1.0;
+                if (position[d] < row_start) {
+                    position[d] = nnz;
+                    coarse->col_indices[nnz] = d;
+                    coarse->values[nnz] = weight;
+                    nnz++;
+                } else {
+                    coarse->values[position[d]] += weight;
+                }
+                coarse->diag[c] += weight;
+            }
+        }
+        coarse->row_ptr[c + 1] = nnz;
+    }
+
+    free(member_ptr);
+    free(members);
+    free(position);
+    return 1;
+}
+
+// pseudoodwrotnosc gestej macierzy Laplace'a najgrubszego poziomu; jadro
+// (wektory stale na skladowych spojnosci) jest pomijane
+static double *build_coarse_pseudoinverse(MultigridLevel *level) {
+    int n = level->n;
+    double *dense = calloc((size_t)n * n, sizeof(double));
+    double *eigenvalues = malloc(n * sizeof(double));
+    double *eigenvectors = malloc((size_t)n * n * sizeof(double));
+    double *pinv = calloc((size_t)n * n, sizeof(double));
+    if (!dense || !eigenvalues || !eigenvectors || !pinv) {
+        free(dense);
+        free(eigenvalues);
+        free(eigenvectors);
+        free(pinv);
+        return NULL;
+    }
+
+    for (int i = 0; i < n; i++) {
+        dense[(size_t)i * n + i] = level->diag[i];
+        for (int j = level->row_ptr[i]; j < level->row_ptr[i + 1]; j++) {
+            double weight = level->values ? level->values[j] : 1.0;
+            dense[(size_t)i * n + level->col_indices[j]] -= weight;
+        }
+    }
+
+    if (!symmetric_eigen_decomposition(dense, n, eigenvalues, eigenvectors)) {
+        free(dense);
+        free(eigenvalues);
+        free(eigenvectors);
+        free(pinv);
+        return NULL;
+    }
+
+    double cutoff = 1e-9 * fabs(eigenvalues[n - 1]);
+    for (int k = 0; k < n; k++) {
+        if (eigenvalues[k] <= cutoff) {
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            double scaled = eigenvectors[(size_t)i * n + k] / eigenvalues[k];
+            for (int j = 0; j < n; j++) {
+                pinv[(size_t)i * n + j] += scaled * eigenvectors[(size_t)j * n + k];
+            }
+        }
+    }
+
+    free(dense);
+    free(eigenvalues);
+    free(eigenvectors);
+    return pinv;
+}
+
+static int build_multigrid(Preconditioner *precond, SparseMatrix *adj_matrix) {
+    precond->levels = calloc(MULTIGRID_MAX_LEVELS, sizeof(MultigridLevel));
+    if (!precond->levels) {
+        return 0;
+    }
+
+    MultigridLevel *finest = &precond->levels[0];
+    finest->n = adj_matrix->rows;
+    finest->row_ptr = adj_matrix->row_ptr;
+    finest->col_indices = adj_matrix->col_indices;
+    finest->values = adj_matrix->values;
+    finest->owns_matrix = 0;
+    precond->num_levels = 1; // zeby free_preconditioner zwolnil poziom po bledzie alokacji
+    finest->diag = malloc(finest->n * sizeof(double));
+    if (!finest->diag || !alloc_level_vectors(finest)) {
+        return 0;
+    }
+    for (int i = 0; i < finest->n; i++) {
+        double degree = 0.0;
+        for (int j = finest->row_ptr[i]; j < finest->row_ptr[i + 1]; j++) {
+            degree += finest->values ? finest->values[j] : 1.0;
+        }
+        finest->diag[i] = degree;
+    }
+
+    while (precond->num_levels < MULTIGRID_MAX_LEVELS) {
+        MultigridLevel *fine = &precond->levels[precond->num_levels - 1];
+        if (fine->n <= MULTIGRID_COARSEST_SIZE) {
+            break;
+        }
+        fine->aggregate = malloc(fine->n * sizeof(int));
+        if (!fine->aggregate) {
+            return 0;
+        }
+        int num_aggregates = build_aggregates(fine);
+        if (num_aggregates > MULTIGRID_MIN_COARSENING * fine->n) {
+            free(fine->aggregate);
+            fine->aggregate = NULL;
+            break;
+        }
+        if (!build_coarse_level(fine, &precond->levels[precond->num_levels], num_aggregates)) {
+            precond->num_levels++; // zeby free_preconditioner zwolnil czesciowy poziom
+            return 0;
+        }
+        precond->num_levels++;
+    }
+
+    MultigridLevel *coarsest = &precond->levels[precond->num_levels - 1];
+    if (coarsest->n <= MULTIGRID_DIRECT_SIZE) {
+        precond->coarse_pinv = build_coarse_pseudoinverse(coarsest);
+        if (!precond->coarse_pinv) {
+            return 0;
+        }
+    }
+
+    verbose("Multigrid: %d poziomów, najgrubszy ma %d wierzchołków\n", precond->num_levels,
+            coarsest->n);
+    return 1;
+}
+
+Preconditioner *create_preconditioner(SparseMatrix *adj_matrix, PreconditionerType type) {
+    if (!adj_matrix || type == PRECONDITIONER_NONE) {
+        return NULL;
+    }
+
+    Preconditioner *precond = calloc(1, sizeof(Preconditioner));
+    if (!precond) {
+        error("Nie udało się zaalokować pamięci dla prekondycjonera.\n");
+        return NULL;
+    }
+    precond->n = adj_matrix->rows;
+
+    if (type == PRECONDITIONER_JACOBI) {
+        precond->apply = apply_jacobi;
+        precond->inv_diag = malloc(precond->n * sizeof(double));
+        if (!precond->inv_diag) {
+            error("Nie udało się zaalokować pamięci dla prekondycjonera Jacobiego.\n");
+            free_preconditioner(precond);
+            return NULL;
+        }
+        for (int i = 0; i < precond->n; i++) {
+            int degree = adj_matrix->row_ptr[i + 1] - adj_matrix->row_ptr[i];
+            precond->inv_diag[i] = degree > 0 ? 1.0 / degree : 1.0;
+        }
+    } else {
+        precond->apply = apply_multigrid;
+        if (!build_multigrid(precond, adj_matrix)) {
+            error("Nie udało się zbudować hierarchii multigrid.\n");
+            free_preconditioner(precond);
+            return NULL;
+        }
+    }
+    return precond;
+}
+
+void free_preconditioner(Preconditioner *precond) {
+    if (!precond) {
+        return;
+    }
+
+    free(precond->inv_diag);
+    if (precond->levels) {
+        for (int l = 0; l < precond->num_levels; l++) {
+            MultigridLevel *level = &precond->levels[l];
+            if (level->owns_matrix) {
+                free(level->row_ptr);
+                free(level->col_indices);
+                free(level->values);
+            }
+            free(level->diag);
+            free(level->aggregate);
+            free(level->r);
+            free(level->x);
+            free(level->tmp);
+        }
+        free(precond->levels);
+    }
+    free(precond->coarse_pinv);
+    free(precond);
+}
@@ -0,0 +1,32 @@
+#ifndef PRECONDITIONER_H
+#define PRECONDITIONER_H
+#include "args_parser.h"
+#include "graph.h"
+
+typedef struct {
+    int n;             // Liczba wierzcholkow na danym poziomie
+    int *row_ptr;      // Macierz sasiedztwa poziomu (CSR)
+    int *col_indices;
+    double *values;    // Wagi krawedzi (NULL - wszystkie rowne 1)
+    double *diag;      // Wazone stopnie wierzcholkow
+    int *aggregate;    // Numer agregatu na nastepnym poziomie (NULL na najgrubszym)
+    double *r;         // Prawa strona rownania na poziomie
+    double *x;         // Przyblizone rozwiazanie
+    double *tmp;       // Bufor roboczy
+    int owns_matrix;   // 0 dla poziomu 0, ktory wskazuje na tablice grafu
+} MultigridLevel;
+
+typedef struct Preconditioner {
+    int n;
+    // z = M^-1 r dla jednego wektora dlugosci n
+    void (*apply)(struct Preconditioner *self, const double *r, double *z);
+    double *inv_diag;         // Jacobi: odwrotnosci stopni
+    MultigridLevel *levels;   // Multigrid: poziomy od najdrobniejszego
+    int num_levels;
+    double *coarse_pinv;      // Pseudoodwrotnosc macierzy najgrubszego poziomu
+} Preconditioner;
+
+Preconditioner *create_preconditioner(SparseMatrix *adj_matrix, PreconditionerType type);
+void free_preconditioner(Preconditioner *precond);
+
+#endif
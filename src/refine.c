@@ -0,0 +1,697 @@
+#include "refine.h"
+#include "log_utils.h"
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FM_MIN_STALL_MOVES 64    // ruchy bez poprawy, po ktorych przebieg jest przerywany...
+#define FM_STALL_FRACTION 0.01   // ...albo taki ulamek wierzcholkow, jesli wiekszy
+#define LP_BLOCK_SIZE 1024        // wierzcholki pobierane naraz przez watek
+#define LP_MIN_PARALLEL_VERTICES 4096 // ponizej tego rozmiaru runda jest sekwencyjna
+#define LP_MIN_MOVED_FRACTION 0.001   // runda z mniejszym ulamkiem ruchow konczy rafinacje
+
+// Kolejka priorytetowa kubelkowa: kubelek na kazda mozliwa wartosc zysku,
+// w kazdym dwukierunkowa lista wierzcholkow. Wstawienie, usuniecie i zmiana
+// klucza sa O(1), a wskaznik najwiekszego niepustego kubelka schodzi w dol
+// leniwie przy pobieraniu.
+typedef struct {
+    int offset; // zysk g jest w kubelku g + offset
+    int max;    // indeks najwyzszego byc moze niepustego kubelka
+    int *head;  // 2 * offset + 1 kubelkow
+    int *next;
+    int *prev;
+    int *key;    // zysk wierzcholka w kolejce
+    char *queued;
+} GainBuckets;
+
+static int buckets_init(GainBuckets *q, int n, int max_gain) {
+    q->offset = max_gain;
+    q->max = -1;
+    q->head = malloc((2 * (size_t)max_gain + 1) * sizeof(int));
+    q->next = malloc((n > 0 ? n : 1) * sizeof(int));
+    q->prev = malloc((n > 0 ? n : 1) * sizeof(int));
+    q->key = malloc((n > 0 ? n : 1) * sizeof(int));
+    q->queued = calloc(n > 0 ? n : 1, 1);
+    if (!q->head || !q->next || !q->prev || !q->key || !q->queued) {
+        return 0;
+    }
+    for (int b = 0; b <= 2 * max_gain; b++) {
+        q->head[b] = -1;
+    }
+    return 1;
+}
+
+static void buckets_free(GainBuckets *q) {
+    free(q->head);
+    free(q->next);
+    free(q->prev);
+    free(q->key);
+    free(q->queued);
+}
+
+static void buckets_insert(GainBuckets *q, int v, int gain) {
+    int b = gain + q->offset;
+    q->key[v] = gain;
+    q->prev[v] = -1;
+    q->next[v] = q->head[b];
+    if (q->head[b] >= 0) {
+        q->prev[q->head[b]] = v;
+    }
+    q->head[b] = v;
+    q->queued[v] = 1;
+    if (b > q->max) {
+        q->max = b;
+    }
+}
+
+static void buckets_remove(GainBuckets *q, int v) {
+    int b = q->key[v] + q->offset;
+    if (q->prev[v] >= 0) {
+        q->next[q->prev[v]] = q->next[v];
+    } else {
+        q->head[b] = q->next[v];
+    }
+    if (q->next[v] >= 0) {
+        q->prev[q->next[v]] = q->prev[v];
+    }
+    q->queued[v] = 0;
+}
+
+// wierzcholek o najwiekszym zysku albo -1, gdy kolejka jest pusta
+static int buckets_top(GainBuckets *q) {
+    while (q->max >= 0 && q->head[q->max] < 0) {
+        q->max--;
+    }
+    return q->max >= 0 ? q->head[q->max] : -1;
+}
+
+// Spojnosc wierzcholkow z czesciami: dla kazdego wierzcholka suma wag
+// krawedzi do wlasnej czesci, do pozostalych i zwarta lista sasiednich obcych
+// czesci z wagami (w puli pod indeksami xadj[v].., bo czesci nie ma wiecej
+// niz sasiadow). Zbior wierzcholkow brzegowych (external > 0) jest
+// utrzymywany przy kazdym ruchu, wiec rafinacja nie przeglada calego grafu.
+typedef struct {
+    Graph *graph;
+    int *partition;
+    int *internal;      // waga krawedzi do wlasnej czesci
+    int *external;      // waga krawedzi do innych czesci
+    int *num_adjacent;  // liczba sasiednich obcych czesci
+    int *adj_part;      // pula list czesci, lista v od xadj[v]
+    int *adj_weight;    // wagi krawedzi do czesci z adj_part
+    int *boundary;      // wierzcholki brzegowe
+    int *boundary_pos;  // pozycja w boundary albo -1
+    int num_boundary;
+} Connectivity;
+
+static void boundary_update(Connectivity *c, int v) {
+    int on_boundary = c->external[v] > 0;
+    if (on_boundary && c->boundary_pos[v] < 0) {
+        c->boundary_pos[v] = c->num_boundary;
+        c->boundary[c->num_boundary++] = v;
+    } else if (!on_boundary && c->boundary_pos[v] >= 0) {
+        int last = c->boundary[--c->num_boundary];
+        c->boundary[c->boundary_pos[v]] = last;
+        c->boundary_pos[last] = c->boundary_pos[v];
+        c->boundary_pos[v] = -1;
+    }
+}
+
+// zmienia wage krawedzi v do obcej czesci part o delta; pusty wpis znika z listy
+static void adjacent_add(Connectivity *c, int v, int part, int delta) {
+    int *parts = c->adj_part + c->graph->xadj[v];
+    int *weights = c->adj_weight + c->graph->xadj[v];
+    for (int t = 0; t < c->num_adjacent[v]; t++) {
+        if (parts[t] == part) {
+            weights[t] += delta;
+            if (weights[t] == 0) {
+                int last = --c->num_adjacent[v];
+                parts[t] = parts[last];
+                weights[t] = weights[last];
+            }
+            return;
+        }
+    }
+    parts[c->num_adjacent[v]] = part;
+    weights[c->num_adjacent[v]] = delta;
+    c->num_adjacent[v]++;
+}
+
+// waga krawedzi v do czesci part (0, gdy nie sasiaduje) i usuniecie wpisu
+static int adjacent_take(Connectivity *c, int v, int part) {
+    int *parts = c->adj_part + c->graph->xadj[v];
+    int *weights = c->adj_weight + c->graph->xadj[v];
+    for (int t = 0; t < c->num_adjacent[v]; t++) {
+        if (parts[t] == part) {
+            int weight = weights[t];
+            int last = --c->num_adjacent[v];
+            parts[t] = parts[last];
+            weights[t] = weights[last];
+            return weight;
+        }
+    }
+    return 0;
+}
+
+static int connectivity_init(Connectivity *c, Graph *graph, int *partition) {
+    int n = graph->num_vertices;
+    int nnz = graph->xadj[n];
+    c->graph = graph;
+    c->partition = partition;
+    c->internal = malloc((n > 0 ? n : 1) * sizeof(int));
+    c->external = malloc((n > 0 ? n : 1) * sizeof(int));
+    c->num_adjacent = malloc((n > 0 ? n : 1) * sizeof(int));
+    c->adj_part = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    c->adj_weight = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    c->boundary = malloc((n > 0 ? n : 1) * sizeof(int));
+    c->boundary_pos = malloc((n > 0 ? n : 1) * sizeof(int));
+    c->num_boundary = 0;
+    if (!c->internal || !c->external || !c->num_adjacent || !c->adj_part || !c->adj_weight ||
+        !c->boundary || !c->boundary_pos) {
+        return 0;
+    }
+    for (int v = 0; v < n; v++) {
+        c->internal[v] = 0;
+        c->external[v] = 0;
+        c->num_adjacent[v] = 0;
+        c->boundary_pos[v] = -1;
+        for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+            int p = partition[graph->adjncy[j]];
+            int weight = graph->adjwgt ? graph->adjwgt[j] : 1;
+            if (p == partition[v]) {
+                c->internal[v] += weight;
+            } else {
+                c->external[v] += weight;
+                adjacent_add(c, v, p, weight);
+            }
+        }
+        boundary_update(c, v);
+    }
+    return 1;
+}
+
+static void connectivity_free(Connectivity *c) {
+    free(c->internal);
+    free(c->external);
+    free(c->num_adjacent);
+    free(c->adj_part);
+    free(c->adj_weight);
+    free(c->boundary);
+    free(c->boundary_pos);
+}
+
+// przeniesienie v do czesci to z poprawieniem zapisow v i jego sasiadow
+static void move_vertex(Connectivity *c, int *part_sizes, int v, int to) {
+    Graph *graph = c->graph;
+    int from = c->partition[v];
+    int weight = graph->vwgt ? graph->vwgt[v] : 1;
+    part_sizes[from] -= weight;
+    part_sizes[to] += weight;
+    c->partition[v] = to;
+
+    int old_internal = c->internal[v];
+    c->internal[v] = adjacent_take(c, v, to);
+    if (old_internal > 0) {
+        adjacent_add(c, v, from, old_internal);
+    }
+    c->external[v] += old_internal - c->internal[v];
+    boundary_update(c, v);
+
+    for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+        int u = graph->adjncy[j];
+        int edge_weight = graph->adjwgt ? graph->adjwgt[j] : 1;
+        int part = c->partition[u];
+        if (part == from) {
+            c->internal[u] -= edge_weight;
+            c->external[u] += edge_weight;
+            adjacent_add(c, u, to, edge_weight);
+        } else if (part == to) {
+            c->internal[u] += edge_weight;
+            c->external[u] -= edge_weight;
+            adjacent_add(c, u, from, -edge_weight);
+        } else {
+            adjacent_add(c, u, from, -edge_weight);
+            adjacent_add(c, u, to, edge_weight);
+        }
+        boundary_update(c, u);
+    }
+}
+
+// Najlepszy dopuszczalny ruch v do sasiedniej czesci (ta, ktora nie
+// przekroczy limitu rozmiaru). Zwraca czesc docelowa albo -1 i zysk w *gain;
+// przy rownym zysku wybierana jest mniejsza czesc.
+static int best_move(Connectivity *c, const int *part_sizes, int max_allowed_size, int v,
+                     int *gain) {
+    Graph *graph = c->graph;
+    int weight = graph->vwgt ? graph->vwgt[v] : 1;
+    const int *parts = c->adj_part + graph->xadj[v];
+    const int *weights = c->adj_weight + graph->xadj[v];
+    int target = -1;
+    int best_gain = 0;
+    for (int t = 0; t < c->num_adjacent[v]; t++) {
+        int p = parts[t];
+        if (part_sizes[p] + weight > max_allowed_size) {
+            continue;
+        }
+        int g = weights[t] - c->internal[v];
+        if (target < 0 || g > best_gain ||
+            (g == best_gain && part_sizes[p] < part_sizes[target])) {
+            target = p;
+            best_gain = g;
+        }
+    }
+    *gain = best_gain;
+    return target;
+}
+
+// Wieloczesciowa rafinacja Fiduccii-Mattheysesa. W kazdym przebiegu
+// wierzcholki brzegowe czekaja w kolejce kubelkowej wedlug zysku
+// najlepszego dopuszczalnego ruchu; pobierany jest zawsze ten o najwiekszym
+// zysku, nawet ujemnym, przenoszony i blokowany do konca przebiegu, a zyski
+// jego sasiadow sa poprawiane. Na koniec przebiegu ruchy po najlepszym
+// prefiksie sa cofane. Zaden ruch nie przekracza max_allowed_size. Zwraca
+// laczne zmniejszenie liczby przecietych krawedzi.
+int fm_refine(Graph *graph, PartitionResult *result, int max_allowed_size, int passes) {
+    int n = graph->num_vertices;
+    int *partition = result->partition;
+    int *part_sizes = result->part_sizes;
+
+    int max_gain = 1;
+    for (int v = 0; v < n; v++) {
+        int degree = 0;
+        for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+            degree += graph->adjwgt ? graph->adjwgt[j] : 1;
+        }
+        if (degree > max_gain) {
+            max_gain = degree;
+        }
+    }
+
+    GainBuckets queue;
+    Connectivity conn;
+    int *moved_vertices = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *moved_from = malloc((n > 0 ? n : 1) * sizeof(int));
+    char *locked = calloc(n > 0 ? n : 1, 1);
+    int ok = buckets_init(&queue, n, max_gain);
+    ok = connectivity_init(&conn, graph, partition) && ok;
+    if (!ok || !moved_vertices || !moved_from || !locked) {
+        error("Nie udało się zaalokować pamięci dla rafinacji FM.\n");
+        buckets_free(&queue);
+        connectivity_free(&conn);
+        free(moved_vertices);
+        free(moved_from);
+        free(locked);
+        return 0;
+    }
+
+    int stall_limit = (int)(FM_STALL_FRACTION * n);
+    if (stall_limit < FM_MIN_STALL_MOVES) {
+        stall_limit = FM_MIN_STALL_MOVES;
+    }
+
+    int total_gain = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        for (int b = 0; b < conn.num_boundary; b++) {
+            int v = conn.boundary[b];
+            int gain;
+            if (best_move(&conn, part_sizes, max_allowed_size, v, &gain) >= 0) {
+                buckets_insert(&queue, v, gain);
+            }
+        }
+
+        int num_moves = 0;
+        int gain_sum = 0;
+        int best_sum = 0;
+        int best_moves = 0;
+        int v;
+        while ((v = buckets_top(&queue)) >= 0 && num_moves - best_moves < stall_limit) {
+            buckets_remove(&queue, v);
+            int gain;
+            int target = best_move(&conn, part_sizes, max_allowed_size, v, &gain);
+            if (target < 0) {
+                continue;
+            }
+            if (gain < queue.key[v]) {
+                // klucz byl nieaktualny (zmienily sie rozmiary czesci)
+                buckets_insert(&queue, v, gain);
+                continue;
+            }
+
+            moved_vertices[num_moves] = v;
+            moved_from[num_moves] = partition[v];
+            move_vertex(&conn, part_sizes, v, target);
+            locked[v] = 1;
+            num_moves++;
+            gain_sum += gain;
+            if (gain_sum > best_sum) {
+                best_sum = gain_sum;
+                best_moves = num_moves;
+            }
+
+            for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+                int u = graph->adjncy[j];
+                if (locked[u]) {
+                    continue;
+                }
+                if (queue.queued[u]) {
+                    buckets_remove(&queue, u);
+                }
+                int u_gain;
+                if (best_move(&conn, part_sizes, max_allowed_size, u, &u_gain) >= 0) {
+                    buckets_insert(&queue, u, u_gain);
+                }
+            }
+        }
+
+        // cofniecie ruchow po najlepszym prefiksie
+        for (int m = num_moves - 1; m >= best_moves; m--) {
+            move_vertex(&conn, part_sizes, moved_vertices[m], moved_from[m]);
+        }
+        for (int m = 0; m < num_moves; m++) {
+            locked[moved_vertices[m]] = 0;
+        }
+        while ((v = buckets_top(&queue)) >= 0) {
+            buckets_remove(&queue, v);
+        }
+
+        total_gain += best_sum;
+        if (best_sum == 0) {
+            break;
+        }
+    }
+
+    buckets_free(&queue);
+    connectivity_free(&conn);
+    free(moved_vertices);
+    free(moved_from);
+    free(locked);
+    return total_gain;
+}
+
+// najlzejsza czesc rozna od exclude
+static int lightest_part(const int *part_sizes, int num_parts, int exclude) {
+    int lightest = -1;
+    for (int p = 0; p < num_parts; p++) {
+        if (p != exclude && (lightest < 0 || part_sizes[p] < part_sizes[lightest])) {
+            lightest = p;
+        }
+    }
+    return lightest;
+}
+
+// ruch wyrownujacy: najlepszy dopuszczalny do sasiedniej czesci, a gdy
+// takiej nie ma i allow_remote, do najlzejszej czesci (zysk -internal)
+static int balance_move(Connectivity *c, const int *part_sizes, int num_parts,
+                        int max_allowed_size, int v, int allow_remote, int *gain) {
+    int target = best_move(c, part_sizes, max_allowed_size, v, gain);
+    if (target >= 0 || !allow_remote) {
+        return target;
+    }
+    int weight = c->graph->vwgt ? c->graph->vwgt[v] : 1;
+    int lightest = lightest_part(part_sizes, num_parts, c->partition[v]);
+    if (lightest >= 0 && part_sizes[lightest] + weight <= max_allowed_size) {
+        *gain = -c->internal[v];
+        return lightest;
+    }
+    return -1;
+}
+
+// Przywracanie rownowagi: z czesci przekraczajacych max_allowed_size
+// przenoszone sa wierzcholki o najwiekszym zysku (najmniejszym wzroscie
+// przeciecia) z kolejki kubelkowej. Najpierw brane sa wierzcholki brzegowe
+// (do sasiednich czesci z wolnym miejscem), a dopiero gdy ich zabraknie,
+// wszystkie wierzcholki nadal przepelnionych czesci, takze do czesci
+// niesasiadujacych. Kazdy wierzcholek przenoszony jest co najwyzej raz.
+// Zwraca 1, gdy wszystkie czesci mieszcza sie w limicie.
+int fm_balance(Graph *graph, PartitionResult *result, int max_allowed_size) {
+    int n = graph->num_vertices;
+    int num_parts = result->num_parts;
+    int *partition = result->partition;
+    int *part_sizes = result->part_sizes;
+
+    int overweight = 0;
+    for (int p = 0; p < num_parts; p++) {
+        overweight += part_sizes[p] > max_allowed_size;
+    }
+    if (overweight == 0) {
+        return 1;
+    }
+
+    int max_gain = 1;
+    for (int v = 0; v < n; v++) {
+        int degree = 0;
+        for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+            degree += graph->adjwgt ? graph->adjwgt[j] : 1;
+        }
+        if (degree > max_gain) {
+            max_gain = degree;
+        }
+    }
+
+    GainBuckets queue;
+    Connectivity conn;
+    char *locked = calloc(n > 0 ? n : 1, 1);
+    int ok = buckets_init(&queue, n, max_gain);
+    ok = connectivity_init(&conn, graph, partition) && ok;
+    if (!ok || !locked) {
+        error("Nie udało się zaalokować pamięci dla wyrównania podziału.\n");
+        buckets_free(&queue);
+        connectivity_free(&conn);
+        free(locked);
+        return 0;
+    }
+
+    for (int allow_remote = 0; allow_remote <= 1 && overweight > 0; allow_remote++) {
+        if (!allow_remote) {
+            for (int b = 0; b < conn.num_boundary; b++) {
+                int v = conn.boundary[b];
+                int gain;
+                if (part_sizes[partition[v]] > max_allowed_size &&
+                    balance_move(&conn, part_sizes, num_parts, max_allowed_size, v, 0,
+                                 &gain) >= 0) {
+                    buckets_insert(&queue, v, gain);
+                }
+            }
+        } else {
+            for (int v = 0; v < n; v++) {
+                int gain;
+                if (!locked[v] && part_sizes[partition[v]] > max_allowed_size &&
+                    balance_move(&conn, part_sizes, num_parts, max_allowed_size, v, 1,
+                                 &gain) >= 0) {
+                    buckets_insert(&queue, v, gain);
+                }
+            }
+        }
+
+        int v;
+        while (overweight > 0 && (v = buckets_top(&queue)) >= 0) {
+            buckets_remove(&queue, v);
+            int from = partition[v];
+            if (part_sizes[from] <= max_allowed_size) {
+                continue;
+            }
+            int gain;
+            int target = balance_move(&conn, part_sizes, num_parts, max_allowed_size, v,
+                                      allow_remote, &gain);
+            if (target < 0) {
+                continue;
+            }
+            if (gain < queue.key[v]) {
+                buckets_insert(&queue, v, gain);
+                continue;
+            }
+
+            move_vertex(&conn, part_sizes, v, target);
+            locked[v] = 1;
+            if (part_sizes[from] <= max_allowed_size) {
+                overweight--;
+            }
+
+            for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+                int u = graph->adjncy[j];
+                if (locked[u] || part_sizes[partition[u]] <= max_allowed_size) {
+                    continue;
+                }
+                if (queue.queued[u]) {
+                    buckets_remove(&queue, u);
+                }
+                int u_gain;
+                if (balance_move(&conn, part_sizes, num_parts, max_allowed_size, u, allow_remote,
+                                 &u_gain) >= 0) {
+                    buckets_insert(&queue, u, u_gain);
+                }
+            }
+        }
+        while ((v = buckets_top(&queue)) >= 0) {
+            buckets_remove(&queue, v);
+        }
+    }
+
+    buckets_free(&queue);
+    connectivity_free(&conn);
+    free(locked);
+    return overweight == 0;
+}
+
+// Najlepsza czesc dla v wedlug wag krawedzi do sasiednich czesci: ta o
+// najwiekszej wadze, scisle wiekszej niz do wlasnej czesci, w ktorej v sie
+// zmiesci (przy rownej wadze mniejsza). rating ma num_parts zer i po
+// powrocie znow je ma. Zwraca -1, gdy zaden ruch nie zmniejsza przeciecia.
+static int lp_best_part(Graph *graph, const int *partition, const int *part_sizes,
+                        int max_allowed_size, int v, int *rating, int *touched) {
+    int weight = graph->vwgt ? graph->vwgt[v] : 1;
+    int num_touched = 0;
+    for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+        int p = partition[graph->adjncy[j]];
+        if (rating[p] == 0) {
+            touched[num_touched++] = p;
+        }
+        rating[p] += graph->adjwgt ? graph->adjwgt[j] : 1;
+    }
+
+    int own = partition[v];
+    int target = -1;
+    int best_rating = rating[own];
+    int target_size = 0;
+    for (int t = 0; t < num_touched; t++) {
+        int p = touched[t];
+        int size = part_sizes[p];
+        if (p != own && size + weight <= max_allowed_size &&
+            (rating[p] > best_rating || (target >= 0 && rating[p] == best_rating &&
+                                         size < target_size))) {
+            target = p;
+            best_rating = rating[p];
+            target_size = size;
+        }
+    }
+    for (int t = 0; t < num_touched; t++) {
+        rating[touched[t]] = 0;
+    }
+    return target;
+}
+
+// Rezerwuje miejsce na wierzcholek o wadze weight w czesci part, jesli
+// zmiesci sie w limicie. Petla compare-and-swap nigdy nie zapisuje rozmiaru
+// ponad limit, wiec licznik pozostaje poprawny takze przy rezerwacjach z
+// wielu watkow naraz (OpenMP nie ma porownania z wymiana przed wersja 5.1).
+static int reserve_part(int *part_sizes, int part, int weight, int max_allowed_size) {
+    int size = __atomic_load_n(&part_sizes[part], __ATOMIC_RELAXED);
+    while (size + weight <= max_allowed_size) {
+        if (__atomic_compare_exchange_n(&part_sizes[part], &size, size + weight, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Rafinacja propagacja etykiet z ograniczeniem rozmiaru. Kazda runda ma dwie
+// fazy. Najpierw watki pobieraja bloki wierzcholkow i dla kazdego aktywnego
+// wierzcholka wybieraja sasiednia czesc, z ktora laczy go najwiecej
+// krawedzi; podzial i rozmiary czesci sa w tej fazie tylko czytane, wiec
+// kandydaci nie zaleza od kolejnosci watkow. Potem ruchy sa wykonywane po
+// kolei wedlug numerow wierzcholkow: miejsce w czesci docelowej rezerwuje
+// reserve_part, ktora nie dopuszcza przekroczenia max_allowed_size, a ruch
+// wierzcholka, ktorego sasiad zmienil juz w tej rundzie czesc, jest
+// wybierany od nowa. Aktywne w nastepnej rundzie sa tylko wierzcholki z
+// przeniesionym sasiadem, a sasiedzi wierzcholkow przeniesionych w ostatniej
+// rundzie sa na koniec sprawdzani jeszcze raz. Wynik nie zalezy od liczby
+// watkow. Zwraca liczbe przeniesien.
+int lp_refine(Graph *graph, PartitionResult *result, int max_allowed_size, int rounds) {
+    int n = graph->num_vertices;
+    int num_parts = result->num_parts;
+    int *partition = result->partition;
+    int *part_sizes = result->part_sizes;
+    int max_threads = omp_get_max_threads();
+    if (rounds <= 0) {
+        return 0;
+    }
+
+    char *active = malloc(n > 0 ? n : 1);
+    char *next_active = calloc(n > 0 ? n : 1, 1);
+    int *candidate = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *rating = calloc((size_t)max_threads * num_parts, sizeof(int));
+    int *touched = malloc((size_t)max_threads * num_parts * sizeof(int));
+    if (!active || !next_active || !candidate || !rating || !touched) {
+        error("Nie udało się zaalokować pamięci dla propagacji etykiet.\n");
+        free(active);
+        free(next_active);
+        free(candidate);
+        free(rating);
+        free(touched);
+        return 0;
+    }
+    memset(active, 1, n);
+
+    int total_moves = 0;
+    for (int round = 0; round < rounds; round++) {
+#pragma omp parallel if (n >= LP_MIN_PARALLEL_VERTICES)
+        {
+            int *my_rating = rating + (size_t)omp_get_thread_num() * num_parts;
+            int *my_touched = touched + (size_t)omp_get_thread_num() * num_parts;
+#pragma omp for schedule(dynamic, LP_BLOCK_SIZE)
+            for (int v = 0; v < n; v++) {
+                candidate[v] = active[v] ? lp_best_part(graph, partition, part_sizes,
+                                                        max_allowed_size, v, my_rating,
+                                                        my_touched)
+                                         : -1;
+            }
+        }
+
+        // next_active[v] jest ustawione, gdy sasiad v zmienil juz czesc w tej
+        // rundzie, wiec kandydat v mogl sie zdezaktualizowac
+        int moves = 0;
+        for (int v = 0; v < n; v++) {
+            int target = candidate[v];
+            if (target >= 0 && next_active[v]) {
+                target = lp_best_part(graph, partition, part_sizes, max_allowed_size, v, rating,
+                                      touched);
+            }
+            if (target < 0) {
+                continue;
+            }
+            int weight = graph->vwgt ? graph->vwgt[v] : 1;
+            if (!reserve_part(part_sizes, target, weight, max_allowed_size)) {
+                continue;
+            }
+            part_sizes[partition[v]] -= weight;
+            partition[v] = target;
+            moves++;
+            for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+                next_active[graph->adjncy[j]] = 1;
+            }
+        }
+
+        total_moves += moves;
+        char *swap = active;
+        active = next_active;
+        next_active = swap;
+        memset(next_active, 0, n);
+        if (moves <= LP_MIN_MOVED_FRACTION * n) {
+            break;
+        }
+    }
+
+    // naprawa konfliktow: ruch sasiada wykonany po v w tej samej rundzie mogl
+    // uczynic ruch v (albo pozostanie v) niekorzystnym
+    for (int v = 0; v < n; v++) {
+        if (!active[v]) {
+            continue;
+        }
+        int target = lp_best_part(graph, partition, part_sizes, max_allowed_size, v, rating,
+                                  touched);
+        if (target >= 0) {
+            int weight = graph->vwgt ? graph->vwgt[v] : 1;
+            part_sizes[partition[v]] -= weight;
+            part_sizes[target] += weight;
+            partition[v] = target;
+            total_moves++;
+        }
+    }
+
+    free(active);
+    free(next_active);
+    free(candidate);
+    free(rating);
+    free(touched);
+    return total_moves;
+}
@@ -0,0 +1,10 @@
+#ifndef REFINE_H
+#define REFINE_H
+#include "graph.h"
+#include "partitioner.h"
+
+int fm_balance(Graph *graph, PartitionResult *result, int max_allowed_size);
+int fm_refine(Graph *graph, PartitionResult *result, int max_allowed_size, int passes);
+int lp_refine(Graph *graph, PartitionResult *result, int max_allowed_size, int rounds);
+
+#endif
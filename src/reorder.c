@@ -0,0 +1,345 @@
+#include "reorder.h"
+#include "io_handler.h"
+#include "log_utils.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RCM_PERIPHERAL_SWEEPS 5 // limit przebiegow BFS przy szukaniu wierzcholka peryferyjnego
+#define INSERTION_SORT_LIMIT 32 // dluzsze listy sasiadow sortowane sa przez qsort
+
+typedef struct {
+    uint64_t key;
+    int vertex;
+} OrderKey;
+
+static int compare_order_keys(const void *a, const void *b) {
+    const OrderKey *ka = a;
+    const OrderKey *kb = b;
+    if (ka->key != kb->key) {
+        return ka->key < kb->key ? -1 : 1;
+    }
+    return ka->vertex - kb->vertex;
+}
+
+// sortowanie przez wstawianie dla krotkich list, a qsort dla dlugich
+// (wierzcholki o bardzo wysokim stopniu)
+static void sort_order_keys(OrderKey *keys, int size) {
+    if (size > INSERTION_SORT_LIMIT) {
+        qsort(keys, size, sizeof(OrderKey), compare_order_keys);
+        return;
+    }
+    for (int i = 1; i < size; i++) {
+        OrderKey value = keys[i];
+        int j = i - 1;
+        while (j >= 0 && compare_order_keys(&keys[j], &value) > 0) {
+            keys[j + 1] = keys[j];
+            j--;
+        }
+        keys[j + 1] = value;
+    }
+}
+
+static inline int degree(Graph *graph, int v) { return graph->xadj[v + 1] - graph->xadj[v]; }
+
+static int max_degree(Graph *graph) {
+    int max = 0;
+    for (int v = 0; v < graph->num_vertices; v++) {
+        if (degree(graph, v) > max) {
+            max = degree(graph, v);
+        }
+    }
+    return max;
+}
+
+// przeplata bity wspolrzednych: kolejne bity x na pozycjach parzystych, y na nieparzystych
+static uint64_t morton_key(uint32_t x, uint32_t y) {
+    uint64_t key = 0;
+    for (int bit = 0; bit < 32; bit++) {
+        key |= (uint64_t)((x >> bit) & 1) << (2 * bit);
+        key |= (uint64_t)((y >> bit) & 1) << (2 * bit + 1);
+    }
+    return key;
+}
+
+// odleglosc punktu wzdluz krzywej Hilberta na siatce 2^32 x 2^32
+static uint64_t hilbert_key(uint32_t x, uint32_t y) {
+    uint64_t key = 0;
+    for (uint32_t s = 1u << 31; s > 0; s >>= 1) {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        key += (uint64_t)s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            uint32_t t = x;
+            x = y;
+            y = t;
+        }
+    }
+    return key;
+}
+
+// kolejnosc wzdluz krzywej wypelniajacej na wspolrzednych row/col z pliku
+static int *space_filling_ordering(Graph *graph, ReorderType type) {
+    int n = graph->num_vertices;
+    int *perm = malloc((n > 0 ? n : 1) * sizeof(int));
+    OrderKey *keys = malloc((n > 0 ? n : 1) * sizeof(OrderKey));
+    if (!perm || !keys) {
+        error("Nie udało się zaalokować pamięci dla przenumerowania wierzchołków.\n");
+        free(perm);
+        free(keys);
+        return NULL;
+    }
+    for (int v = 0; v < n; v++) {
+        uint32_t x = (uint32_t)graph->col[v];
+        uint32_t y = (uint32_t)graph->row[v];
+        keys[v].key = type == REORDER_HILBERT ? hilbert_key(x, y) : morton_key(x, y);
+        keys[v].vertex = v;
+    }
+    qsort(keys, n, sizeof(OrderKey), compare_order_keys);
+    for (int i = 0; i < n; i++) {
+        perm[i] = keys[i].vertex;
+    }
+    free(keys);
+    return perm;
+}
+
+// BFS od root w obrebie skladowej; queue dostaje wierzcholki w kolejnosci
+// odwiedzin, level ich odleglosci (na koniec przywracane do -1). Zwraca liczbe
+// odwiedzonych, a *last_level_start poczatek ostatniego poziomu w queue.
+static int bfs_levels(Graph *graph, int root, int *level, int *queue, int *last_level_start,
+                      int *eccentricity) {
+    int head = 0;
+    int tail = 0;
+    queue[tail++] = root;
+    level[root] = 0;
+    *last_level_start = 0;
+    while (head < tail) {
+        int v = queue[head++];
+        for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+            int u = graph->adjncy[j];
+            if (level[u] < 0) {
+                level[u] = level[v] + 1;
+                if (level[u] > level[queue[tail - 1]]) {
+                    *last_level_start = tail;
+                }
+                queue[tail++] = u;
+            }
+        }
+    }
+    *eccentricity = level[queue[tail - 1]];
+    for (int i = 0; i < tail; i++) {
+        level[queue[i]] = -1;
+    }
+    return tail;
+}
+
+// wierzcholek pseudo-peryferyjny (George, Liu): z ostatniego poziomu BFS
+// wybierany jest ten o najmniejszym stopniu, dopoki ekscentrycznosc rosnie
+static int pseudo_peripheral_vertex(Graph *graph, int root, int *level, int *queue) {
+    int last_start;
+    int eccentricity;
+    int size = bfs_levels(graph, root, level, queue, &last_start, &eccentricity);
+    for (int sweep = 0; sweep < RCM_PERIPHERAL_SWEEPS; sweep++) {
+        int candidate = queue[last_start];
+        for (int i = last_start + 1; i < size; i++) {
+            if (degree(graph, queue[i]) < degree(graph, candidate)) {
+                candidate = queue[i];
+            }
+        }
+        int candidate_eccentricity;
+        size = bfs_levels(graph, candidate, level, queue, &last_start, &candidate_eccentricity);
+        if (candidate_eccentricity <= eccentricity) {
+            break;
+        }
+        root = candidate;
+        eccentricity = candidate_eccentricity;
+    }
+    return root;
+}
+
+// odwrocony algorytm Cuthilla-McKee: BFS od wierzcholka pseudo-peryferyjnego
+// kazdej skladowej, sasiedzi dokladani w kolejnosci rosnacych stopni, a cala
+// kolejnosc na koniec odwracana. Zaweza pasmo macierzy, wiec sasiedzi
+// wierzcholka leza blisko siebie w pamieci.
+static int *rcm_ordering(Graph *graph) {
+    int n = graph->num_vertices;
+    int *perm = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *level = malloc((n > 0 ? n : 1) * sizeof(int));
+    int *queue = malloc((n > 0 ? n : 1) * sizeof(int));
+    char *visited = calloc(n > 0 ? n : 1, 1);
+    OrderKey *roots = malloc((n > 0 ? n : 1) * sizeof(OrderKey));
+    OrderKey *neighbors = malloc((max_degree(graph) + 1) * sizeof(OrderKey));
+    if (!perm || !level || !queue || !visited || !roots || !neighbors) {
+        error("Nie udało się zaalokować pamięci dla przenumerowania wierzchołków.\n");
+        free(perm);
+        free(level);
+        free(queue);
+        free(visited);
+        free(roots);
+        free(neighbors);
+        return NULL;
+    }
+    for (int v = 0; v < n; v++) {
+        level[v] = -1;
+        roots[v].key = degree(graph, v);
+        roots[v].vertex = v;
+    }
+    // skladowe zaczynane od wierzcholkow o najmniejszym stopniu
+    qsort(roots, n, sizeof(OrderKey), compare_order_keys);
+
+    int count = 0;
+    for (int r = 0; r < n; r++) {
+        if (visited[roots[r].vertex]) {
+            continue;
+        }
+        int start = pseudo_peripheral_vertex(graph, roots[r].vertex, level, queue);
+        int head = count;
+        perm[count++] = start;
+        visited[start] = 1;
+        while (head < count) {
+            int v = perm[head++];
+            int first = count;
+            for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+                int u = graph->adjncy[j];
+                if (!visited[u]) {
+                    visited[u] = 1;
+                    perm[count++] = u;
+                }
+            }
+            // nowi sasiedzi po rosnacym stopniu, przy rownym po numerze
+            for (int i = first; i < count; i++) {
+                neighbors[i - first].key = degree(graph, perm[i]);
+                neighbors[i - first].vertex = perm[i];
+            }
+            sort_order_keys(neighbors, count - first);
+            for (int i = first; i < count; i++) {
+                perm[i] = neighbors[i - first].vertex;
+            }
+        }
+    }
+    for (int i = 0; i < n / 2; i++) {
+        int t = perm[i];
+        perm[i] = perm[n - 1 - i];
+        perm[n - 1 - i] = t;
+    }
+
+    free(level);
+    free(queue);
+    free(visited);
+    free(roots);
+    free(neighbors);
+    return perm;
+}
+
+// Zwraca permutacje perm[nowy] = stary albo NULL przy bledzie. Krzywe
+// wypelniajace wymagaja wspolrzednych row/col; bez nich uzywany jest RCM.
+int *compute_vertex_ordering(Graph *graph, ReorderType type) {
+    if (!graph || type == REORDER_NONE) {
+        error("Niepoprawne dane wejściowe do przenumerowania wierzchołków.\n");
+        return NULL;
+    }
+    if (type == REORDER_MORTON || type == REORDER_HILBERT) {
+        if (graph->row && graph->col) {
+            return space_filling_ordering(graph, type);
+        }
+        warn("Graf nie ma współrzędnych wierzchołków, używam kolejności RCM.\n");
+    }
+    return rcm_ordering(graph);
+}
+
+// Kopia grafu z wierzcholkami w kolejnosci perm (perm[nowy] = stary); listy
+// sasiadow sa ponownie sortowane, wagi i wspolrzedne przenoszone razem z nimi
+Graph *permute_graph(Graph *graph, const int *perm) {
+    int n = graph->num_vertices;
+    int nnz = graph->xadj[n];
+    Graph *result = calloc(1, sizeof(Graph));
+    int *inverse = malloc((n > 0 ? n : 1) * sizeof(int));
+    OrderKey *row = malloc((max_degree(graph) + 1) * sizeof(OrderKey));
+    if (!result || !inverse || !row) {
+        error("Nie udało się zaalokować pamięci dla przenumerowanego grafu.\n");
+        free(result);
+        free(inverse);
+        free(row);
+        return NULL;
+    }
+    result->num_vertices = n;
+    result->num_edges = graph->num_edges;
+    result->max_row_nodes = graph->max_row_nodes;
+    result->num_groups = graph->num_groups;
+    result->xadj = malloc((n + 1) * sizeof(int));
+    result->adjncy = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    int ok = result->xadj && result->adjncy;
+    if (graph->adjwgt) {
+        result->adjwgt = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+        ok = ok && result->adjwgt;
+    }
+    if (graph->vwgt) {
+        result->vwgt = malloc((n > 0 ? n : 1) * sizeof(int));
+        ok = ok && result->vwgt;
+    }
+    if (graph->row && graph->col) {
+        result->row = malloc((n > 0 ? n : 1) * sizeof(int));
+        result->col = malloc((n > 0 ? n : 1) * sizeof(int));
+        ok = ok && result->row && result->col;
+    }
+    if (!ok) {
+        error("Nie udało się zaalokować pamięci dla przenumerowanego grafu.\n");
+        free(inverse);
+        free(row);
+        free_memory(result);
+        return NULL;
+    }
+
+    for (int i = 0; i < n; i++) {
+        inverse[perm[i]] = i;
+    }
+    result->xadj[0] = 0;
+    for (int i = 0; i < n; i++) {
+        int old = perm[i];
+        int start = result->xadj[i];
+        int size = degree(graph, old);
+        // wiersz sortowany po nowych numerach sasiadow; vertex to pozycja w
+        // starym wierszu, zeby przeniesc wage krawedzi
+        for (int k = 0; k < size; k++) {
+            row[k].key = inverse[graph->adjncy[graph->xadj[old] + k]];
+            row[k].vertex = k;
+        }
+        sort_order_keys(row, size);
+        for (int k = 0; k < size; k++) {
+            result->adjncy[start + k] = (int)row[k].key;
+            if (result->adjwgt) {
+                result->adjwgt[start + k] = graph->adjwgt[graph->xadj[old] + row[k].vertex];
+            }
+        }
+        result->xadj[i + 1] = start + size;
+        if (result->vwgt) {
+            result->vwgt[i] = graph->vwgt[old];
+        }
+        if (result->row) {
+            result->row[i] = graph->row[old];
+            result->col[i] = graph->col[old];
+        }
+    }
+
+    free(inverse);
+    free(row);
+    return result;
+}
+
+// najwieksza odleglosc |v - u| po wszystkich krawedziach
+int graph_bandwidth(Graph *graph) {
+    int bandwidth = 0;
+    for (int v = 0; v < graph->num_vertices; v++) {
+        for (int j = graph->xadj[v]; j < graph->xadj[v + 1]; j++) {
+            int distance = abs(graph->adjncy[j] - v);
+            if (distance > bandwidth) {
+                bandwidth = distance;
+            }
+        }
+    }
+    return bandwidth;
+}
@@ -0,0 +1,10 @@
+#ifndef REORDER_H
+#define REORDER_H
+#include "args_parser.h"
+#include "graph.h"
+
+int *compute_vertex_ordering(Graph *graph, ReorderType type);
+Graph *permute_graph(Graph *graph, const int *perm);
+int graph_bandwidth(Graph *graph);
+
+#endif
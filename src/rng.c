@@ -0,0 +1,27 @@
+#include "rng.h"
+
+#define RNG_GOLDEN_GAMMA 0x9e3779b97f4a7c15ULL
+
+// funkcja mieszajaca SplitMix64 - bijekcja na 64 bitach
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void rng_init(RngState *rng, uint64_t seed, uint64_t stream) {
+    rng->key = mix64(mix64(seed + RNG_GOLDEN_GAMMA) ^ (stream * RNG_GOLDEN_GAMMA));
+    rng->counter = 0;
+}
+
+uint64_t rng_next(RngState *rng) {
+    rng->counter++;
+    return mix64(rng->key + rng->counter * RNG_GOLDEN_GAMMA);
+}
+
+// mnozenie zamiast modulo (Lemire) - pomijalne obciazenie dla malych bound
+int rng_int(RngState *rng, int bound) {
+    return (int)(((rng_next(rng) >> 32) * (uint64_t)bound) >> 32);
+}
+
+double rng_double(RngState *rng) { return (rng_next(rng) >> 11) * 0x1.0p-53; }
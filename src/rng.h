@@ -0,0 +1,18 @@
+#ifndef RNG_H
+#define RNG_H
+#include <stdint.h>
+
+// Generator licznikowy (SplitMix64): kazdy strumien jest wyznaczony przez
+// ziarno i numer strumienia, wiec wyniki nie zaleza od kolejnosci ani od
+// liczby watkow, ktore z niego korzystaja
+typedef struct {
+    uint64_t key;     // Skrot ziarna i numeru strumienia
+    uint64_t counter; // Liczba wylosowanych dotad wartosci
+} RngState;
+
+void rng_init(RngState *rng, uint64_t seed, uint64_t stream);
+uint64_t rng_next(RngState *rng);
+int rng_int(RngState *rng, int bound); // z przedzialu [0, bound)
+double rng_double(RngState *rng);      // z przedzialu [0, 1)
+
+#endif
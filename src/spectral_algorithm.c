@@ -1,70 +1,364 @@
 #include "spectral_algorithm.h"
 #include "log_utils.h"
 #include "printfcolor.h"
+#include "vector_kernels.h"
 #include <math.h>
+#include <omp.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-// macierz sasiedztwa minus macierz stopni
-SparseMatrix *build_laplacian_matrix(SparseMatrix *adj_matrix) {
-    SparseMatrix *degree_matrix = create_degree_matrix(adj_matrix);
-    if (!degree_matrix) {
-        error("Nie udało się stworzyć macierzy stopni.\n");
-        return NULL;
+#define SPECTRAL_ROW_BLOCK 64           // wiersze przepisywane naraz przy budowie zanurzenia
+#define SPECTRAL_DROP_TOLERANCE 1e-10   // kolumny skrocone ponizej tej proporcji sa odrzucane
+#define SPECTRAL_CHOLQR_PIVOT 1e-10     // minimalny stosunek kwadratu osi Cholesky'ego do normy
+#define SPECTRAL_ALIGNMENT 64           // wyrownanie tablicy zanurzenia (linia pamieci podrecznej)
+#define SPECTRAL_TILE_ROWS 16 // wiersze kopiowane naraz przy skladaniu kolumn w miejscu
+#define SPECTRAL_MIN_PARALLEL_ROWS 4096 // mniejsze bloki sa przetwarzane sekwencyjnie
+
+// y = L * x = deg * x - A * x liczone bezposrednio z symetrycznej macierzy
+// sasiedztwa, bez budowania macierzy Laplace'a ani macierzy stopni; wiersze
+// sa dzielone miedzy watki po rowno wedlug liczby niezerowych elementow
+void apply_laplacian(SparseMatrix *adj_matrix, DenseVector *x, DenseVector *y) {
+    const int *row_ptr = adj_matrix->row_ptr;
+    const int *col_indices = adj_matrix->col_indices;
+    const double *in = x->values;
+    double *out = y->values;
+    double start = omp_get_wtime();
+
+#pragma omp parallel if (spmv_use_threads(adj_matrix))
+    {
+        int begin, end;
+        nnz_balanced_row_range(row_ptr, adj_matrix->rows, omp_get_thread_num(),
+                               omp_get_num_threads(), &begin, &end);
+        for (int i = begin; i < end; i++) {
+            double sum = (row_ptr[i + 1] - row_ptr[i]) * in[i];
+            for (int j = row_ptr[i]; j < row_ptr[i + 1]; j++) {
+                sum -= in[col_indices[j]];
+            }
+            out[i] = sum;
+        }
     }
+    record_spmv(omp_get_wtime() - start, spmv_traffic_bytes(adj_matrix, 1));
+}
 
-    SparseMatrix *laplacian_matrix = malloc(sizeof(SparseMatrix));
-    if (!laplacian_matrix) {
-        error("Nie udało się zaalokować pamięci dla macierzy Laplace'a.\n");
-        free_sparse_matrix(degree_matrix);
-        return NULL;
+// zakres wierszy [begin, end) fragmentu chunk
+static inline void chunk_range(int n, int chunk, int *begin, int *end) {
+    *begin = (int)((long long)n * chunk / SPECTRAL_CHUNKS);
+    *end = (int)((long long)n * (chunk + 1) / SPECTRAL_CHUNKS);
+}
+
+int init_block_workspace(BlockWorkspace *ws, int max_cols, int max_block, int n) {
+    size_t square = (size_t)max_cols * max_cols;
+    ws->max_cols = max_cols;
+    ws->partial = malloc(SPECTRAL_CHUNKS * square * sizeof(double));
+    ws->row = malloc((size_t)SPECTRAL_CHUNKS * SPECTRAL_TILE_ROWS * max_cols * sizeof(double));
+    ws->coef = malloc(square * sizeof(double));
+    ws->gram = malloc(square * sizeof(double));
+    ws->norms = malloc(max_cols * sizeof(double));
+    ws->dots = malloc(max_cols * sizeof(double));
+    ws->columns = malloc((size_t)n * max_block * sizeof(double));
+    if (!ws->partial || !ws->row || !ws->coef || !ws->gram || !ws->norms || !ws->dots ||
+        !ws->columns) {
+        error("Nie udało się zaalokować pamięci dla operacji blokowych.\n");
+        free_block_workspace(ws);
+        return 0;
     }
+    return 1;
+}
 
-    laplacian_matrix->rows = adj_matrix->rows;
-    laplacian_matrix->cols = adj_matrix->cols;
-    laplacian_matrix->nnz = adj_matrix->nnz + degree_matrix->nnz;
+void free_block_workspace(BlockWorkspace *ws) {
+    free(ws->partial);
+    free(ws->row);
+    free(ws->coef);
+    free(ws->gram);
+    free(ws->norms);
+    free(ws->dots);
+    free(ws->columns);
+    ws->partial = NULL;
+    ws->row = NULL;
+    ws->coef = NULL;
+    ws->gram = NULL;
+    ws->norms = NULL;
+    ws->dots = NULL;
+    ws->columns = NULL;
+}
 
-    laplacian_matrix->values = malloc(laplacian_matrix->nnz * sizeof(double));
-    laplacian_matrix->col_indices = malloc(laplacian_matrix->nnz * sizeof(int));
-    laplacian_matrix->row_ptr = malloc((laplacian_matrix->rows + 1) * sizeof(int));
+// g (cx x cy) = X^T Y; kazdy fragment wierszy dodaje iloczyny zewnetrzne
+// swoich wierszy do wlasnej sumy czesciowej
+void block_inner_products(const double *x, int cx, const double *y, int cy, int ld, int n,
+                          BlockWorkspace *ws, double *g) {
+    size_t size = (size_t)cx * cy;
+#pragma omp parallel for schedule(static) if (n >= SPECTRAL_MIN_PARALLEL_ROWS)
+    for (int chunk = 0; chunk < SPECTRAL_CHUNKS; chunk++) {
+        double *part = ws->partial + chunk * size;
+        int begin, end;
+        chunk_range(n, chunk, &begin, &end);
+        memset(part, 0, size * sizeof(double));
+        vec_rows_gram(x + (size_t)begin * ld, ld, cx, y + (size_t)begin * ld, ld, cy, end - begin,
+                      part);
+    }
+    memset(g, 0, size * sizeof(double));
+    for (int chunk = 0; chunk < SPECTRAL_CHUNKS; chunk++) {
+        const double *part = ws->partial + chunk * size;
+        for (size_t k = 0; k < size; k++) {
+            g[k] += part[k];
+        }
+    }
+}
 
-    if (!laplacian_matrix->values || !laplacian_matrix->col_indices || !laplacian_matrix->row_ptr) {
-        error("Nie udało się zaalokować pamięci dla elementów macierzy Laplace'a.\n");
+// Y[:, 0..cy) = X[:, 0..cx) * c, gdzie c ma cx wierszy po cy elementow;
+// kafelki wierszy X sa najpierw kopiowane do bufora, wiec y moze wskazywac na x
+void block_combine(const double *x, int cx, const double *c, int cy, double *y, int ld, int n,
+                   BlockWorkspace *ws) {
+#pragma omp parallel for schedule(static) if (n >= SPECTRAL_MIN_PARALLEL_ROWS)
+    for (int chunk = 0; chunk < SPECTRAL_CHUNKS; chunk++) {
+        double *tile = ws->row + (size_t)chunk * SPECTRAL_TILE_ROWS * ws->max_cols;
+        int begin, end;
+        chunk_range(n, chunk, &begin, &end);
+        for (int r0 = begin; r0 < end; r0 += SPECTRAL_TILE_ROWS) {
+            int rows = end - r0 < SPECTRAL_TILE_ROWS ? end - r0 : SPECTRAL_TILE_ROWS;
+            for (int r = 0; r < rows; r++) {
+                memcpy(tile + (size_t)r * cx, x + (size_t)(r0 + r) * ld, cx * sizeof(double));
+            }
+            vec_rows_gemm(tile, cx, cx, c, cy, y + (size_t)r0 * ld, ld, rows, 0);
+        }
+    }
+}
 
-        free(laplacian_matrix->values);
-        free(laplacian_matrix->col_indices);
-        free(laplacian_matrix->row_ptr);
-        free(laplacian_matrix);
+// X[:, 0..cx) += Q[:, 0..cq) * c
+static void block_update(const double *q, int cq, const double *c, double *x, int cx, int ld,
+                         int n) {
+#pragma omp parallel for schedule(static) if (n >= SPECTRAL_MIN_PARALLEL_ROWS)
+    for (int chunk = 0; chunk < SPECTRAL_CHUNKS; chunk++) {
+        int begin, end;
+        chunk_range(n, chunk, &begin, &end);
+        vec_rows_gemm(q + (size_t)begin * ld, ld, cq, c, cx, x + (size_t)begin * ld, ld,
+                      end - begin, 1);
+    }
+}
 
-        free_sparse_matrix(degree_matrix);
-        return NULL;
+// norms[c] = ||AX[:, c] - theta[c] * X[:, c]|| dla c < cx, a przy ax == NULL
+// zwykle normy kolumn X
+void block_residual_norms(const double *x, const double *ax, int cx, const double *theta, int ld,
+                          int n, BlockWorkspace *ws, double *norms) {
+#pragma omp parallel for schedule(static) if (n >= SPECTRAL_MIN_PARALLEL_ROWS)
+    for (int chunk = 0; chunk < SPECTRAL_CHUNKS; chunk++) {
+        double *part = ws->partial + (size_t)chunk * cx;
+        int begin, end;
+        chunk_range(n, chunk, &begin, &end);
+        memset(part, 0, cx * sizeof(double));
+        for (int r = begin; r < end; r++) {
+            const double *xr = x + (size_t)r * ld;
+            const double *axr = ax ? ax + (size_t)r * ld : NULL;
+            for (int c = 0; c < cx; c++) {
+                double v = axr ? axr[c] - theta[c] * xr[c] : xr[c];
+                part[c] += v * v;
+            }
+        }
+    }
+    for (int c = 0; c < cx; c++) {
+        double sum = 0.0;
+        for (int chunk = 0; chunk < SPECTRAL_CHUNKS; chunk++) {
+            sum += ws->partial[(size_t)chunk * cx + c];
+        }
+        norms[c] = sqrt(sum);
+    }
+}
+
+// odejmuje od kolumn X ich srednie, czyli rzut na wektor staly; L * X sie
+// nie zmienia, bo wektor staly nalezy do jadra L
+static void remove_column_means(double *x, int cx, int ld, int n, BlockWorkspace *ws) {
+#pragma omp parallel for schedule(static) if (n >= SPECTRAL_MIN_PARALLEL_ROWS)
+    for (int chunk = 0; chunk < SPECTRAL_CHUNKS; chunk++) {
+        double *part = ws->partial + (size_t)chunk * cx;
+        int begin, end;
+        chunk_range(n, chunk, &begin, &end);
+        memset(part, 0, cx * sizeof(double));
+        for (int r = begin; r < end; r++) {
+            const double *xr = x + (size_t)r * ld;
+            for (int c = 0; c < cx; c++) {
+                part[c] += xr[c];
+            }
+        }
     }
-    int nnz_index = 0;
-    laplacian_matrix->row_ptr[0] = 0;
+    double *mean = ws->row;
+    for (int c = 0; c < cx; c++) {
+        double sum = 0.0;
+        for (int chunk = 0; chunk < SPECTRAL_CHUNKS; chunk++) {
+            sum += ws->partial[(size_t)chunk * cx + c];
+        }
+        mean[c] = sum / n;
+    }
+#pragma omp parallel for schedule(static) if (n >= SPECTRAL_MIN_PARALLEL_ROWS)
+    for (int r = 0; r < n; r++) {
+        double *xr = x + (size_t)r * ld;
+        for (int c = 0; c < cx; c++) {
+            xr[c] -= mean[c];
+        }
+    }
+}
 
-    for (int row = 0; row < adj_matrix->rows; row++) {
-        int degree = degree_matrix->values[row];
+// Gram-Schmidt kolumna po kolumnie wewnatrz bloku X, ktory jest juz
+// ortogonalny do Q i do wektora stalego. Blok jest na ten czas przepisywany
+// kolumnami do ws->columns, zeby kazda kolumna lezala w pamieci po kolei, a
+// wykonane operacje sa zapisywane w macierzy t (kolumna j to wspolczynniki
+// nowej kolumny j), ktora potem przeksztalca AX. Kolumny skrocone ponizej
+// SPECTRAL_DROP_TOLERANCE swojej normy poczatkowej (ws->norms) sa
+// odrzucane, a pozostale przesuwane na poczatek bloku; zwraca ich liczbe.
+static int orthonormalize_columns(double *x, double *ax, int cx, int ld, int n,
+                                  BlockWorkspace *ws) {
+    double *columns = ws->columns;
+    double *t = ws->coef;
+    for (int r = 0; r < n; r++) {
+        for (int c = 0; c < cx; c++) {
+            columns[(size_t)c * n + r] = x[(size_t)r * ld + c];
+        }
+    }
+
+    int kept = 0;
+    for (int c = 0; c < cx; c++) {
+        double *w = columns + (size_t)c * n;
+        double *tw = t + (size_t)c * cx;
+        memset(tw, 0, cx * sizeof(double));
+        tw[c] = 1.0;
+        if (ws->norms[c] == 0.0) {
+            continue;
+        }
+        for (int pass = 0; pass < 2; pass++) {
+            vec_multi_dot(columns, n, kept, w, n, ws->dots);
+            vec_multi_axpy(columns, n, kept, ws->dots, w, n);
+            vec_multi_axpy(t, cx, kept, ws->dots, tw, cx);
+        }
+        double norm = vec_nrm2(w, n);
+        if (norm <= SPECTRAL_DROP_TOLERANCE * ws->norms[c]) {
+            continue;
+        }
+        vec_scale(1.0 / norm, w, n);
+        vec_scale(1.0 / norm, tw, cx);
+        if (kept != c) {
+            memcpy(columns + (size_t)kept * n, w, n * sizeof(double));
+            memcpy(t + (size_t)kept * cx, tw, cx * sizeof(double));
+        }
+        kept++;
+    }
 
-        laplacian_matrix->values[nnz_index] = degree;
-        laplacian_matrix->col_indices[nnz_index] = row;
-        nnz_index++;
+    for (int r = 0; r < n; r++) {
+        for (int c = 0; c < kept; c++) {
+            x[(size_t)r * ld + c] = columns[(size_t)c * n + r];
+        }
+    }
+    if (ax && kept > 0) {
+        for (int i = 0; i < cx; i++) {
+            for (int j = 0; j < kept; j++) {
+                ws->gram[i * kept + j] = t[(size_t)j * cx + i];
+            }
+        }
+        block_combine(ax, cx, ws->gram, kept, ax, ld, n, ws);
+    }
+    return kept;
+}
 
-        for (int j = adj_matrix->row_ptr[row]; j < adj_matrix->row_ptr[row + 1]; j++) {
-            laplacian_matrix->values[nnz_index] = -adj_matrix->values[j];
-            laplacian_matrix->col_indices[nnz_index] = adj_matrix->col_indices[j];
-            nnz_index++;
+// Rozklad Cholesky'ego g = R^T R (m x m) i odwrotnosc trojkatnej R zapisana
+// w rinv; g jest nadpisywane przez R. Zwraca 0, gdy ktorys kwadrat osi spada
+// ponizej SPECTRAL_CHOLQR_PIVOT poczatkowego elementu diagonali, czyli blok
+// jest zbyt bliski zaleznemu, zeby Cholesky-QR zachowal ortogonalnosc.
+static int cholesky_inverse(double *g, int m, double *rinv) {
+    for (int j = 0; j < m; j++) {
+        double diagonal = g[j * m + j];
+        for (int k = 0; k < j; k++) {
+            diagonal -= g[k * m + j] * g[k * m + j];
         }
+        if (!(diagonal > SPECTRAL_CHOLQR_PIVOT * g[j * m + j])) {
+            return 0;
+        }
+        double pivot = sqrt(diagonal);
+        g[j * m + j] = pivot;
+        for (int i = j + 1; i < m; i++) {
+            double value = g[j * m + i];
+            for (int k = 0; k < j; k++) {
+                value -= g[k * m + j] * g[k * m + i];
+            }
+            g[j * m + i] = value / pivot;
+        }
+    }
+    for (int j = m - 1; j >= 0; j--) {
+        rinv[j * m + j] = 1.0 / g[j * m + j];
+        for (int i = 0; i < j; i++) {
+            rinv[j * m + i] = 0.0;
+        }
+        for (int i = j + 1; i < m; i++) {
+            double value = 0.0;
+            for (int k = j + 1; k <= i; k++) {
+                value += g[j * m + k] * rinv[k * m + i];
+            }
+            rinv[j * m + i] = -value * rinv[j * m + j];
+        }
+    }
+    return 1;
+}
 
-        laplacian_matrix->row_ptr[row + 1] = nnz_index;
+// Ortonormalizuje blok X (cx kolumn) wzgledem wektora stalego, ortonormalnego
+// bloku Q (cq kolumn) i samego siebie; AX i AQ, jesli podane, sa
+// przeksztalcane tak samo. Rzut na Q jest liczony dla calego bloku naraz,
+// dwukrotnie, a sam blok jest ortonormalizowany dwukrotnym Cholesky-QR
+// (X = X R^-1 dla X^T X = R^T R). Gdy rozklad zawodzi, bo kolumny sa prawie
+// zalezne, blok przechodzi przez Gram-Schmidta kolumna po kolumnie, ktory
+// odrzuca kolumny zalezne i przesuwa pozostale na poczatek bloku; zwraca
+// liczbe zachowanych kolumn.
+int orthonormalize_block(double *x, double *ax, int cx, const double *q, const double *aq, int cq,
+                         int ld, int n, BlockWorkspace *ws) {
+    if (cx == 0) {
+        return 0;
     }
+    block_residual_norms(x, NULL, cx, NULL, ld, n, ws, ws->norms);
+    for (int pass = 0; pass < 2; pass++) {
+        remove_column_means(x, cx, ld, n, ws);
+        if (cq > 0) {
+            block_inner_products(q, cq, x, cx, ld, n, ws, ws->coef);
+            for (int k = 0; k < cq * cx; k++) {
+                ws->coef[k] = -ws->coef[k];
+            }
+            block_update(q, cq, ws->coef, x, cx, ld, n);
+            if (ax) {
+                block_update(aq, cq, ws->coef, ax, cx, ld, n);
+            }
+        }
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        block_inner_products(x, cx, x, cx, ld, n, ws, ws->gram);
+        if (pass > 0) {
+            // po pierwszym przebiegu kolumny maja juz norme jednostkowa
+            for (int c = 0; c < cx; c++) {
+                ws->norms[c] = sqrt(ws->gram[c * cx + c]);
+            }
+        }
+        if (!cholesky_inverse(ws->gram, cx, ws->coef)) {
+            return orthonormalize_columns(x, ax, cx, ld, n, ws);
+        }
+        block_combine(x, cx, ws->coef, cx, x, ld, n, ws);
+        if (ax) {
+            block_combine(ax, cx, ws->coef, cx, ax, ld, n, ws);
+        }
+    }
+    return cx;
+}
 
-    free_sparse_matrix(degree_matrix);
-    laplacian_matrix->nnz = nnz_index;
-    return laplacian_matrix;
+// h = S^T (L S) dla ncols kolumn; wynik jest symetryzowany, bo S jest
+// ortonormalna, a L symetryczna
+void projected_laplacian_matrix(const double *s, const double *as, int ncols, int ld, int n,
+                                BlockWorkspace *ws, double *h) {
+    block_inner_products(s, ncols, as, ncols, ld, n, ws, h);
+    for (int i = 0; i < ncols; i++) {
+        for (int j = i + 1; j < ncols; j++) {
+            double value = 0.5 * (h[i * ncols + j] + h[j * ncols + i]);
+            h[i * ncols + j] = value;
+            h[j * ncols + i] = value;
+        }
+    }
 }
 
-DenseVector **compute_eigenvectors(SparseMatrix *laplacian, int num_eigenvectors) {
-    if (!laplacian || num_eigenvectors <= 0 || num_eigenvectors > laplacian->rows) {
+DenseVector **compute_eigenvectors(SparseMatrix *adj_matrix, int num_eigenvectors) {
+    if (!adj_matrix || num_eigenvectors <= 0 || num_eigenvectors > adj_matrix->rows) {
         error("Niepoprawne dane wejściowe.\n");
         return NULL;
     }
@@ -83,15 +377,15 @@ DenseVector **compute_eigenvectors(SparseMatrix *laplacian, int num_eigenvectors
             return NULL;
         }
 
-        eigenvectors[i]->size = laplacian->rows;
-        eigenvectors[i]->values = malloc(laplacian->rows * sizeof(double));
+        eigenvectors[i]->size = adj_matrix->rows;
+        eigenvectors[i]->values = malloc(adj_matrix->rows * sizeof(double));
         if (!eigenvectors[i]->values) {
             error("Nie udało się zaalokować pamięci dla wartości wektora własnego: %d.\n", i);
             free_eigenvectors(eigenvectors, i);
             return NULL;
         }
 
-        for (int j = 0; j < laplacian->rows; ++j) {
+        for (int j = 0; j < adj_matrix->rows; ++j) {
             eigenvectors[i]->values[j] = 2.0 * rand() / RAND_MAX - 1.0;
         }
         normalize_vector(eigenvectors[i]);
@@ -101,8 +395,8 @@ DenseVector **compute_eigenvectors(SparseMatrix *laplacian, int num_eigenvectors
             free_eigenvectors(eigenvectors, i + 1);
             return NULL;
         }
-        new_vector->size = laplacian->rows;
-        new_vector->values = malloc(laplacian->rows * sizeof(double));
+        new_vector->size = adj_matrix->rows;
+        new_vector->values = malloc(adj_matrix->rows * sizeof(double));
         if (!new_vector->values) {
             free(new_vector);
             free_eigenvectors(eigenvectors, i + 1);
@@ -112,26 +406,36 @@ DenseVector **compute_eigenvectors(SparseMatrix *laplacian, int num_eigenvectors
         int max_iterations = 1000;
         double tolerance = 1e-6;
         double prev_eigenvalue = 0.0;
+        int n = adj_matrix->rows;
 
         for (int iter = 0; iter < max_iterations; ++iter) {
-            for (int j = 0; j < laplacian->rows; ++j) {
-                new_vector->values[j] = eigenvectors[i]->values[j];
-            }
+            memcpy(new_vector->values, eigenvectors[i]->values, n * sizeof(double));
 
-            multiply_sparse_matrix_vector(laplacian, new_vector, eigenvectors[i]);
+            apply_laplacian(adj_matrix, new_vector, eigenvectors[i]);
 
+            // ostatnie odjecie rzutu liczy od razu norme wyniku
+            double norm_sq = -1.0;
             for (int k = 0; k < i; ++k) {
-                double proj = dot_product(eigenvectors[i], eigenvectors[k]);
-                for (int j = 0; j < laplacian->rows; ++j) {
-                    eigenvectors[i]->values[j] -= proj * eigenvectors[k]->values[j];
+                double proj = vec_dot(eigenvectors[i]->values, eigenvectors[k]->values, n);
+                if (k == i - 1) {
+                    norm_sq = vec_axpy_nrm2sq(-proj, eigenvectors[k]->values,
+                                              eigenvectors[i]->values, n);
+                } else {
+                    vec_axpy(-proj, eigenvectors[k]->values, eigenvectors[i]->values, n);
                 }
             }
-
-            normalize_vector(eigenvectors[i]);
+            if (norm_sq < 0.0) {
+                norm_sq = vec_dot(eigenvectors[i]->values, eigenvectors[i]->values, n);
+            }
+            if (norm_sq == 0.0) {
+                error("Norma wektora wynosi 0.\n");
+            } else {
+                vec_scale(1.0 / sqrt(norm_sq), eigenvectors[i]->values, n);
+            }
 
             double eigenvalue = 0.0;
-            multiply_sparse_matrix_vector(laplacian, eigenvectors[i], new_vector);
-            eigenvalue = dot_product(eigenvectors[i], new_vector);
+            apply_laplacian(adj_matrix, eigenvectors[i], new_vector);
+            eigenvalue = vec_dot(eigenvectors[i]->values, new_vector->values, n);
 
             if (fabs(eigenvalue - prev_eigenvalue) < tolerance) {
                 break;
@@ -147,3 +451,29 @@ DenseVector **compute_eigenvectors(SparseMatrix *laplacian, int num_eigenvectors
 
     return eigenvectors;
 }
+
+// Zanurzenie spektralne: wiersz v to wspolrzedne wierzcholka v we wszystkich
+// wektorach wlasnych. Jedna wyrownana tablica wierszami, przepisywana blokami
+// wierszy, zeby odczyt z kazdego wektora szedl po kolei. Zwalniana przez free.
+double *create_spectral_embedding(DenseVector **eigenvectors, int num_eigenvectors,
+                                  int num_vertices) {
+    size_t bytes = (size_t)num_vertices * num_eigenvectors * sizeof(double);
+    bytes = (bytes + SPECTRAL_ALIGNMENT - 1) / SPECTRAL_ALIGNMENT * SPECTRAL_ALIGNMENT;
+    double *embedding = aligned_alloc(SPECTRAL_ALIGNMENT, bytes > 0 ? bytes : SPECTRAL_ALIGNMENT);
+    if (!embedding) {
+        error("Nie udało się zaalokować pamięci dla zanurzenia spektralnego.\n");
+        return NULL;
+    }
+#pragma omp parallel for schedule(static)
+    for (int r0 = 0; r0 < num_vertices; r0 += SPECTRAL_ROW_BLOCK) {
+        int rows = num_vertices - r0 < SPECTRAL_ROW_BLOCK ? num_vertices - r0 : SPECTRAL_ROW_BLOCK;
+        for (int j = 0; j < num_eigenvectors; j++) {
+            const double *column = eigenvectors[j]->values + r0;
+            double *out = embedding + (size_t)r0 * num_eigenvectors + j;
+            for (int r = 0; r < rows; r++) {
+                out[(size_t)r * num_eigenvectors] = column[r];
+            }
+        }
+    }
+    return embedding;
+}
@@ -3,7 +3,45 @@
 #include "kmeans.h"
 #include "matrix_ops.h"
 
-SparseMatrix *build_laplacian_matrix(SparseMatrix *adj_matrix);
-DenseVector **compute_eigenvectors(SparseMatrix *laplacian, int num_eigenvectors);
+typedef struct {
+    int iterations;      // Liczba mnozen przez macierz Laplace'a
+    int restarts;        // Liczba zewnetrznych iteracji (restartow, krokow blokowych)
+    int converged;       // Liczba wektorow, ktore osiagnely zadana dokladnosc
+    double max_residual; // Najwieksze residuum ||L x - lambda x|| wsrod wektorow
+} EigensolverStats;
+
+#define SPECTRAL_CHUNKS 32 // stala liczba fragmentow wierszy przy sumach po wierszach bloku
+
+// Bufory operacji na blokach wektorow zapisanych wierszami (element c wiersza
+// r to x[r * ld + c]). Sumy po wierszach sa liczone dla SPECTRAL_CHUNKS
+// stalych fragmentow i dodawane w kolejnosci, wiec wynik nie zalezy od
+// liczby watkow.
+typedef struct {
+    int max_cols;    // Najwieksza liczba kolumn bloku
+    double *partial; // SPECTRAL_CHUNKS x max_cols x max_cols
+    double *row;     // SPECTRAL_CHUNKS x SPECTRAL_TILE_ROWS x max_cols, kafelek na fragment
+    double *coef;    // max_cols x max_cols, wspolczynniki rzutow
+    double *gram;    // max_cols x max_cols
+    double *norms;   // max_cols, normy kolumn przed ortonormalizacja
+    double *dots;    // max_cols
+    double *columns; // n x max_block, ortonormalizowany blok zapisany kolumnami
+} BlockWorkspace;
+
+void apply_laplacian(SparseMatrix *adj_matrix, DenseVector *x, DenseVector *y);
+int init_block_workspace(BlockWorkspace *ws, int max_cols, int max_block, int n);
+void free_block_workspace(BlockWorkspace *ws);
+void block_inner_products(const double *x, int cx, const double *y, int cy, int ld, int n,
+                          BlockWorkspace *ws, double *g);
+void block_combine(const double *x, int cx, const double *c, int cy, double *y, int ld, int n,
+                   BlockWorkspace *ws);
+void block_residual_norms(const double *x, const double *ax, int cx, const double *theta, int ld,
+                          int n, BlockWorkspace *ws, double *norms);
+int orthonormalize_block(double *x, double *ax, int cx, const double *q, const double *aq, int cq,
+                         int ld, int n, BlockWorkspace *ws);
+void projected_laplacian_matrix(const double *s, const double *as, int ncols, int ld, int n,
+                                BlockWorkspace *ws, double *h);
+DenseVector **compute_eigenvectors(SparseMatrix *adj_matrix, int num_eigenvectors);
+double *create_spectral_embedding(DenseVector **eigenvectors, int num_eigenvectors,
+                                 int num_vertices);
 
 #endif
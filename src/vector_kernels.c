@@ -0,0 +1,603 @@
+#include "vector_kernels.h"
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define VEC_ROW_BLOCK 512 // dlugosc fragmentu, ktory zostaje w L1 przy operacjach wielowektorowych
+#define VEC_TILE_ROWS 32  // wiersze bloku czytane naraz przy X^T Y
+
+enum { SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512 };
+
+// wariant wybierany przy pierwszym wywolaniu; kernele wolane sa z regionow
+// rownoleglych, wiec odczyt i zapis sa atomowe (kazdy watek wykrywa to samo)
+static int simd_level(void) {
+    static int cached_level = -1;
+    int level = __atomic_load_n(&cached_level, __ATOMIC_RELAXED);
+    if (level < 0) {
+        int detected = SIMD_SCALAR;
+#if defined(__x86_64__) || defined(__i386__)
+        if (__builtin_cpu_supports("avx512f")) {
+            detected = SIMD_AVX512;
+        } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            detected = SIMD_AVX2;
+        }
+#endif
+        level = detected;
+        __atomic_store_n(&cached_level, level, __ATOMIC_RELAXED);
+    }
+    return level;
+}
+
+static double dot_scalar(const double *x, const double *y, int n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += x[i] * y[i];
+        s1 += x[i + 1] * y[i + 1];
+        s2 += x[i + 2] * y[i + 2];
+        s3 += x[i + 3] * y[i + 3];
+    }
+    for (; i < n; i++) {
+        s0 += x[i] * y[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+static void axpy_scalar(double a, const double *x, double *y, int n) {
+    for (int i = 0; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+static void scale_scalar(double a, double *x, int n) {
+    for (int i = 0; i < n; i++) {
+        x[i] *= a;
+    }
+}
+
+static double axpy_nrm2sq_scalar(double a, const double *x, double *y, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        y[i] += a * x[i];
+        sum += y[i] * y[i];
+    }
+    return sum;
+}
+
+static double sum_scalar(const double *x, int n) {
+    double s0 = 0.0, s1 = 0.0;
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        s0 += x[i];
+        s1 += x[i + 1];
+    }
+    for (; i < n; i++) {
+        s0 += x[i];
+    }
+    return s0 + s1;
+}
+
+static void shift_scalar(double a, double *x, int n) {
+    for (int i = 0; i < n; i++) {
+        x[i] += a;
+    }
+}
+
+static void rows_gram_scalar(const double *x, size_t ldx, int cx, const double *y, size_t ldy,
+                             int cy, int rows, double *g) {
+    for (int r = 0; r < rows; r++) {
+        const double *xr = x + r * ldx;
+        const double *yr = y + r * ldy;
+        for (int i = 0; i < cx; i++) {
+            double xi = xr[i];
+            double *gi = g + (size_t)i * cy;
+            for (int j = 0; j < cy; j++) {
+                gi[j] += xi * yr[j];
+            }
+        }
+    }
+}
+
+static void rows_gemm_scalar(const double *x, size_t ldx, int cx, const double *c, int cy,
+                             double *out, size_t ldo, int rows, int accumulate) {
+    for (int r = 0; r < rows; r++) {
+        const double *xr = x + r * ldx;
+        double *outr = out + r * ldo;
+        if (!accumulate) {
+            for (int j = 0; j < cy; j++) {
+                outr[j] = 0.0;
+            }
+        }
+        for (int i = 0; i < cx; i++) {
+            double xi = xr[i];
+            const double *ci = c + (size_t)i * cy;
+            for (int j = 0; j < cy; j++) {
+                outr[j] += xi * ci[j];
+            }
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Redukcje czyszcza gorne polowki rejestrow (vzeroupper) przed skalarna
+// reszta: kompilator sam tego tu nie robi, a brudny stan AVX spowalnia potem
+// caly kod SSE programu, takze jadra mnozenia przez L.
+
+// dwa niezalezne akumulatory ukrywaja opoznienie FMA
+__attribute__((target("avx2,fma"))) static double dot_avx2(const double *x, const double *y,
+                                                           int n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), acc1);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    _mm256_zeroupper();
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dot_scalar(x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) static void axpy_avx2(double a, const double *x, double *y,
+                                                          int n) {
+    __m256d va = _mm256_set1_pd(a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i,
+                         _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    axpy_scalar(a, x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) static void scale_avx2(double a, double *x, int n) {
+    __m256d va = _mm256_set1_pd(a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(x + i, _mm256_mul_pd(va, _mm256_loadu_pd(x + i)));
+    }
+    scale_scalar(a, x + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) static double axpy_nrm2sq_avx2(double a, const double *x,
+                                                                   double *y, int n) {
+    __m256d va = _mm256_set1_pd(a);
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d vy = _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+        _mm256_storeu_pd(y + i, vy);
+        acc = _mm256_fmadd_pd(vy, vy, acc);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    _mm256_zeroupper();
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) +
+           axpy_nrm2sq_scalar(a, x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) static double sum_avx2(const double *x, int n) {
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_pd(acc, _mm256_loadu_pd(x + i));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    _mm256_zeroupper();
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sum_scalar(x + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) static void shift_avx2(double a, double *x, int n) {
+    __m256d va = _mm256_set1_pd(a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(x + i, _mm256_add_pd(va, _mm256_loadu_pd(x + i)));
+    }
+    shift_scalar(a, x + i, n - i);
+}
+
+__attribute__((target("avx512f"))) static double dot_avx512(const double *x, const double *y,
+                                                            int n) {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), acc0);
+        acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), acc1);
+    }
+    double head = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+    _mm256_zeroupper();
+    return head + dot_scalar(x + i, y + i, n - i);
+}
+
+__attribute__((target("avx512f"))) static void axpy_avx512(double a, const double *x, double *y,
+                                                           int n) {
+    __m512d va = _mm512_set1_pd(a);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(y + i,
+                         _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    }
+    axpy_scalar(a, x + i, y + i, n - i);
+}
+
+__attribute__((target("avx512f"))) static void scale_avx512(double a, double *x, int n) {
+    __m512d va = _mm512_set1_pd(a);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(x + i, _mm512_mul_pd(va, _mm512_loadu_pd(x + i)));
+    }
+    scale_scalar(a, x + i, n - i);
+}
+
+__attribute__((target("avx512f"))) static double axpy_nrm2sq_avx512(double a, const double *x,
+                                                                    double *y, int n) {
+    __m512d va = _mm512_set1_pd(a);
+    __m512d acc = _mm512_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d vy = _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+        _mm512_storeu_pd(y + i, vy);
+        acc = _mm512_fmadd_pd(vy, vy, acc);
+    }
+    double head = _mm512_reduce_add_pd(acc);
+    _mm256_zeroupper();
+    return head + axpy_nrm2sq_scalar(a, x + i, y + i, n - i);
+}
+
+__attribute__((target("avx512f"))) static double sum_avx512(const double *x, int n) {
+    __m512d acc = _mm512_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm512_add_pd(acc, _mm512_loadu_pd(x + i));
+    }
+    double head = _mm512_reduce_add_pd(acc);
+    _mm256_zeroupper();
+    return head + sum_scalar(x + i, n - i);
+}
+
+__attribute__((target("avx512f"))) static void shift_avx512(double a, double *x, int n) {
+    __m512d va = _mm512_set1_pd(a);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(x + i, _mm512_add_pd(va, _mm512_loadu_pd(x + i)));
+    }
+    shift_scalar(a, x + i, n - i);
+}
+
+// Jadra blokow zapisanych wierszami: kolumny wyniku sa dzielone na panele
+// jednego rejestru (ostatni maskowany), a kazdy panel ma cztery niezalezne
+// akumulatory - cztery kolumny x przy X^T Y, cztery wiersze przy X * C.
+__attribute__((target("avx2,fma"))) static __m256i lane_mask_avx2(int count) {
+    return _mm256_cmpgt_epi64(_mm256_set1_epi64x(count), _mm256_setr_epi64x(0, 1, 2, 3));
+}
+
+__attribute__((target("avx2,fma"))) static void gram_add_avx2(double *g, __m256i m, __m256d acc) {
+    _mm256_maskstore_pd(g, m, _mm256_add_pd(_mm256_maskload_pd(g, m), acc));
+}
+
+__attribute__((target("avx2,fma"))) static void rows_gram_avx2(const double *x, size_t ldx, int cx,
+                                                              const double *y, size_t ldy, int cy,
+                                                              int rows, double *g) {
+    for (int r0 = 0; r0 < rows; r0 += VEC_TILE_ROWS) {
+        int r1 = rows - r0 < VEC_TILE_ROWS ? rows : r0 + VEC_TILE_ROWS;
+        for (int j0 = 0; j0 < cy; j0 += 4) {
+            __m256i m = lane_mask_avx2(cy - j0);
+            int i = 0;
+            for (; i + 4 <= cx; i += 4) {
+                __m256d a0 = _mm256_setzero_pd();
+                __m256d a1 = _mm256_setzero_pd();
+                __m256d a2 = _mm256_setzero_pd();
+                __m256d a3 = _mm256_setzero_pd();
+                for (int r = r0; r < r1; r++) {
+                    const double *xr = x + r * ldx + i;
+                    __m256d vy = _mm256_maskload_pd(y + r * ldy + j0, m);
+                    a0 = _mm256_fmadd_pd(_mm256_broadcast_sd(xr), vy, a0);
+                    a1 = _mm256_fmadd_pd(_mm256_broadcast_sd(xr + 1), vy, a1);
+                    a2 = _mm256_fmadd_pd(_mm256_broadcast_sd(xr + 2), vy, a2);
+                    a3 = _mm256_fmadd_pd(_mm256_broadcast_sd(xr + 3), vy, a3);
+                }
+                gram_add_avx2(g + (size_t)i * cy + j0, m, a0);
+                gram_add_avx2(g + (size_t)(i + 1) * cy + j0, m, a1);
+                gram_add_avx2(g + (size_t)(i + 2) * cy + j0, m, a2);
+                gram_add_avx2(g + (size_t)(i + 3) * cy + j0, m, a3);
+            }
+            for (; i < cx; i++) {
+                __m256d a0 = _mm256_setzero_pd();
+                for (int r = r0; r < r1; r++) {
+                    __m256d vy = _mm256_maskload_pd(y + r * ldy + j0, m);
+                    a0 = _mm256_fmadd_pd(_mm256_broadcast_sd(x + r * ldx + i), vy, a0);
+                }
+                gram_add_avx2(g + (size_t)i * cy + j0, m, a0);
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2,fma"))) static void rows_gemm_avx2(const double *x, size_t ldx, int cx,
+                                                              const double *c, int cy, double *out,
+                                                              size_t ldo, int rows,
+                                                              int accumulate) {
+    int r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const double *x0 = x + r * ldx;
+        double *o0 = out + r * ldo;
+        for (int j0 = 0; j0 < cy; j0 += 4) {
+            __m256i m = lane_mask_avx2(cy - j0);
+            __m256d a0 = _mm256_setzero_pd();
+            __m256d a1 = _mm256_setzero_pd();
+            __m256d a2 = _mm256_setzero_pd();
+            __m256d a3 = _mm256_setzero_pd();
+            if (accumulate) {
+                a0 = _mm256_maskload_pd(o0 + j0, m);
+                a1 = _mm256_maskload_pd(o0 + ldo + j0, m);
+                a2 = _mm256_maskload_pd(o0 + 2 * ldo + j0, m);
+                a3 = _mm256_maskload_pd(o0 + 3 * ldo + j0, m);
+            }
+            for (int i = 0; i < cx; i++) {
+                __m256d vc = _mm256_maskload_pd(c + (size_t)i * cy + j0, m);
+                a0 = _mm256_fmadd_pd(_mm256_broadcast_sd(x0 + i), vc, a0);
+                a1 = _mm256_fmadd_pd(_mm256_broadcast_sd(x0 + ldx + i), vc, a1);
+                a2 = _mm256_fmadd_pd(_mm256_broadcast_sd(x0 + 2 * ldx + i), vc, a2);
+                a3 = _mm256_fmadd_pd(_mm256_broadcast_sd(x0 + 3 * ldx + i), vc, a3);
+            }
+            _mm256_maskstore_pd(o0 + j0, m, a0);
+            _mm256_maskstore_pd(o0 + ldo + j0, m, a1);
+            _mm256_maskstore_pd(o0 + 2 * ldo + j0, m, a2);
+            _mm256_maskstore_pd(o0 + 3 * ldo + j0, m, a3);
+        }
+    }
+    for (; r < rows; r++) {
+        const double *xr = x + r * ldx;
+        double *outr = out + r * ldo;
+        for (int j0 = 0; j0 < cy; j0 += 4) {
+            __m256i m = lane_mask_avx2(cy - j0);
+            __m256d a0 = accumulate ? _mm256_maskload_pd(outr + j0, m) : _mm256_setzero_pd();
+            for (int i = 0; i < cx; i++) {
+                __m256d vc = _mm256_maskload_pd(c + (size_t)i * cy + j0, m);
+                a0 = _mm256_fmadd_pd(_mm256_broadcast_sd(xr + i), vc, a0);
+            }
+            _mm256_maskstore_pd(outr + j0, m, a0);
+        }
+    }
+}
+
+__attribute__((target("avx512f"))) static __mmask8 lane_mask_avx512(int count) {
+    return count >= 8 ? 0xFF : (__mmask8)((1u << count) - 1);
+}
+
+__attribute__((target("avx512f"))) static void gram_add_avx512(double *g, __mmask8 m,
+                                                               __m512d acc) {
+    _mm512_mask_storeu_pd(g, m, _mm512_add_pd(_mm512_maskz_loadu_pd(m, g), acc));
+}
+
+__attribute__((target("avx512f"))) static void rows_gram_avx512(const double *x, size_t ldx,
+                                                                int cx, const double *y,
+                                                                size_t ldy, int cy, int rows,
+                                                                double *g) {
+    for (int r0 = 0; r0 < rows; r0 += VEC_TILE_ROWS) {
+        int r1 = rows - r0 < VEC_TILE_ROWS ? rows : r0 + VEC_TILE_ROWS;
+        for (int j0 = 0; j0 < cy; j0 += 8) {
+            __mmask8 m = lane_mask_avx512(cy - j0);
+            int i = 0;
+            for (; i + 4 <= cx; i += 4) {
+                __m512d a0 = _mm512_setzero_pd();
+                __m512d a1 = _mm512_setzero_pd();
+                __m512d a2 = _mm512_setzero_pd();
+                __m512d a3 = _mm512_setzero_pd();
+                for (int r = r0; r < r1; r++) {
+                    const double *xr = x + r * ldx + i;
+                    __m512d vy = _mm512_maskz_loadu_pd(m, y + r * ldy + j0);
+                    a0 = _mm512_fmadd_pd(_mm512_set1_pd(xr[0]), vy, a0);
+                    a1 = _mm512_fmadd_pd(_mm512_set1_pd(xr[1]), vy, a1);
+                    a2 = _mm512_fmadd_pd(_mm512_set1_pd(xr[2]), vy, a2);
+                    a3 = _mm512_fmadd_pd(_mm512_set1_pd(xr[3]), vy, a3);
+                }
+                gram_add_avx512(g + (size_t)i * cy + j0, m, a0);
+                gram_add_avx512(g + (size_t)(i + 1) * cy + j0, m, a1);
+                gram_add_avx512(g + (size_t)(i + 2) * cy + j0, m, a2);
+                gram_add_avx512(g + (size_t)(i + 3) * cy + j0, m, a3);
+            }
+            for (; i < cx; i++) {
+                __m512d a0 = _mm512_setzero_pd();
+                for (int r = r0; r < r1; r++) {
+                    __m512d vy = _mm512_maskz_loadu_pd(m, y + r * ldy + j0);
+                    a0 = _mm512_fmadd_pd(_mm512_set1_pd(x[r * ldx + i]), vy, a0);
+                }
+                gram_add_avx512(g + (size_t)i * cy + j0, m, a0);
+            }
+        }
+    }
+}
+
+__attribute__((target("avx512f"))) static void rows_gemm_avx512(const double *x, size_t ldx,
+                                                                int cx, const double *c, int cy,
+                                                                double *out, size_t ldo, int rows,
+                                                                int accumulate) {
+    int r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const double *x0 = x + r * ldx;
+        double *o0 = out + r * ldo;
+        for (int j0 = 0; j0 < cy; j0 += 8) {
+            __mmask8 m = lane_mask_avx512(cy - j0);
+            __m512d a0 = _mm512_setzero_pd();
+            __m512d a1 = _mm512_setzero_pd();
+            __m512d a2 = _mm512_setzero_pd();
+            __m512d a3 = _mm512_setzero_pd();
+            if (accumulate) {
+                a0 = _mm512_maskz_loadu_pd(m, o0 + j0);
+                a1 = _mm512_maskz_loadu_pd(m, o0 + ldo + j0);
+                a2 = _mm512_maskz_loadu_pd(m, o0 + 2 * ldo + j0);
+                a3 = _mm512_maskz_loadu_pd(m, o0 + 3 * ldo + j0);
+            }
+            for (int i = 0; i < cx; i++) {
+                __m512d vc = _mm512_maskz_loadu_pd(m, c + (size_t)i * cy + j0);
+                a0 = _mm512_fmadd_pd(_mm512_set1_pd(x0[i]), vc, a0);
+                a1 = _mm512_fmadd_pd(_mm512_set1_pd(x0[ldx + i]), vc, a1);
+                a2 = _mm512_fmadd_pd(_mm512_set1_pd(x0[2 * ldx + i]), vc, a2);
+                a3 = _mm512_fmadd_pd(_mm512_set1_pd(x0[3 * ldx + i]), vc, a3);
+            }
+            _mm512_mask_storeu_pd(o0 + j0, m, a0);
+            _mm512_mask_storeu_pd(o0 + ldo + j0, m, a1);
+            _mm512_mask_storeu_pd(o0 + 2 * ldo + j0, m, a2);
+            _mm512_mask_storeu_pd(o0 + 3 * ldo + j0, m, a3);
+        }
+    }
+    for (; r < rows; r++) {
+        const double *xr = x + r * ldx;
+        double *outr = out + r * ldo;
+        for (int j0 = 0; j0 < cy; j0 += 8) {
+            __mmask8 m = lane_mask_avx512(cy - j0);
+            __m512d a0 = accumulate ? _mm512_maskz_loadu_pd(m, outr + j0) : _mm512_setzero_pd();
+            for (int i = 0; i < cx; i++) {
+                __m512d vc = _mm512_maskz_loadu_pd(m, c + (size_t)i * cy + j0);
+                a0 = _mm512_fmadd_pd(_mm512_set1_pd(xr[i]), vc, a0);
+            }
+            _mm512_mask_storeu_pd(outr + j0, m, a0);
+        }
+    }
+}
+#endif
+
+double vec_dot(const double *x, const double *y, int n) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (simd_level()) {
+    case SIMD_AVX512:
+        return dot_avx512(x, y, n);
+    case SIMD_AVX2:
+        return dot_avx2(x, y, n);
+    }
+#endif
+    return dot_scalar(x, y, n);
+}
+
+double vec_nrm2(const double *x, int n) { return sqrt(vec_dot(x, x, n)); }
+
+void vec_axpy(double a, const double *x, double *y, int n) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (simd_level()) {
+    case SIMD_AVX512:
+        axpy_avx512(a, x, y, n);
+        return;
+    case SIMD_AVX2:
+        axpy_avx2(a, x, y, n);
+        return;
+    }
+#endif
+    axpy_scalar(a, x, y, n);
+}
+
+void vec_scale(double a, double *x, int n) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (simd_level()) {
+    case SIMD_AVX512:
+        scale_avx512(a, x, n);
+        return;
+    case SIMD_AVX2:
+        scale_avx2(a, x, n);
+        return;
+    }
+#endif
+    scale_scalar(a, x, n);
+}
+
+double vec_axpy_nrm2sq(double a, const double *x, double *y, int n) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (simd_level()) {
+    case SIMD_AVX512:
+        return axpy_nrm2sq_avx512(a, x, y, n);
+    case SIMD_AVX2:
+        return axpy_nrm2sq_avx2(a, x, y, n);
+    }
+#endif
+    return axpy_nrm2sq_scalar(a, x, y, n);
+}
+
+double vec_sum(const double *x, int n) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (simd_level()) {
+    case SIMD_AVX512:
+        return sum_avx512(x, n);
+    case SIMD_AVX2:
+        return sum_avx2(x, n);
+    }
+#endif
+    return sum_scalar(x, n);
+}
+
+void vec_shift(double a, double *x, int n) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (simd_level()) {
+    case SIMD_AVX512:
+        shift_avx512(a, x, n);
+        return;
+    case SIMD_AVX2:
+        shift_avx2(a, x, n);
+        return;
+    }
+#endif
+    shift_scalar(a, x, n);
+}
+
+// out[i] = basis_i . w dla count wektorow oddalonych o stride; w jest czytany
+// fragmentami, ktore zostaja w L1, wiec z pamieci przechodzi tylko raz
+void vec_multi_dot(const double *basis, size_t stride, int count, const double *w, int n,
+                   double *out) {
+    for (int i = 0; i < count; i++) {
+        out[i] = 0.0;
+    }
+    for (int r0 = 0; r0 < n; r0 += VEC_ROW_BLOCK) {
+        int len = (n - r0 < VEC_ROW_BLOCK) ? n - r0 : VEC_ROW_BLOCK;
+        for (int i = 0; i < count; i++) {
+            out[i] += vec_dot(basis + i * stride + r0, w + r0, len);
+        }
+    }
+}
+
+// w -= sum_i coef[i] * basis_i, jednym przejsciem po w
+void vec_multi_axpy(const double *basis, size_t stride, int count, const double *coef, double *w,
+                    int n) {
+    for (int r0 = 0; r0 < n; r0 += VEC_ROW_BLOCK) {
+        int len = (n - r0 < VEC_ROW_BLOCK) ? n - r0 : VEC_ROW_BLOCK;
+        for (int i = 0; i < count; i++) {
+            vec_axpy(-coef[i], basis + i * stride + r0, w + r0, len);
+        }
+    }
+}
+
+// g (cx x cy) += X^T Y dla rows wierszy blokow zapisanych wierszami (x[r * ldx + i]);
+// wiersze sa brane kafelkami po VEC_TILE_ROWS, ktore zostaja w L1
+void vec_rows_gram(const double *x, size_t ldx, int cx, const double *y, size_t ldy, int cy,
+                   int rows, double *g) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (simd_level()) {
+    case SIMD_AVX512:
+        rows_gram_avx512(x, ldx, cx, y, ldy, cy, rows, g);
+        return;
+    case SIMD_AVX2:
+        rows_gram_avx2(x, ldx, cx, y, ldy, cy, rows, g);
+        return;
+    }
+#endif
+    rows_gram_scalar(x, ldx, cx, y, ldy, cy, rows, g);
+}
+
+// out (rows x cy) = X * c albo out += X * c (accumulate), gdzie c ma cx wierszy
+// po cy elementow; out nie moze pokrywac sie z x
+void vec_rows_gemm(const double *x, size_t ldx, int cx, const double *c, int cy, double *out,
+                   size_t ldo, int rows, int accumulate) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (simd_level()) {
+    case SIMD_AVX512:
+        rows_gemm_avx512(x, ldx, cx, c, cy, out, ldo, rows, accumulate);
+        return;
+    case SIMD_AVX2:
+        rows_gemm_avx2(x, ldx, cx, c, cy, out, ldo, rows, accumulate);
+        return;
+    }
+#endif
+    rows_gemm_scalar(x, ldx, cx, c, cy, out, ldo, rows, accumulate);
+}
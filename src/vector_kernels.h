@@ -0,0 +1,23 @@
+#ifndef VECTOR_KERNELS_H
+#define VECTOR_KERNELS_H
+#include <stddef.h>
+
+// Jadra operacji na gestych wektorach; wariant AVX-512, AVX2+FMA albo
+// skalarny jest wybierany w czasie dzialania
+double vec_dot(const double *x, const double *y, int n);
+double vec_nrm2(const double *x, int n);
+void vec_axpy(double a, const double *x, double *y, int n);              // y += a * x
+void vec_scale(double a, double *x, int n);                              // x *= a
+double vec_axpy_nrm2sq(double a, const double *x, double *y, int n);     // y += a * x, zwraca |y|^2
+double vec_sum(const double *x, int n);
+void vec_shift(double a, double *x, int n);                              // x += a
+void vec_multi_dot(const double *basis, size_t stride, int count, const double *w, int n,
+                   double *out);
+void vec_multi_axpy(const double *basis, size_t stride, int count, const double *coef, double *w,
+                    int n);
+void vec_rows_gram(const double *x, size_t ldx, int cx, const double *y, size_t ldy, int cy,
+                   int rows, double *g);
+void vec_rows_gemm(const double *x, size_t ldx, int cx, const double *c, int cy, double *out,
+                   size_t ldo, int rows, int accumulate);
+
+#endif